@@ -20,6 +20,7 @@
 #include <kservicegroup.h>
 
 #include <QFile>
+#include <QSet>
 #include <QSignalSpy>
 #include <QStandardPaths>
 #include <QThread>
@@ -46,6 +47,7 @@ private Q_SLOTS:
     void testTraderConstraints_data();
     void testTraderConstraints();
     void testQueryByMimeType();
+    void testQueryByMimeTypes();
     void testThreads();
     void testTraderQueryMustRebuildSycoca();
     void testSetPreferredService();
@@ -309,6 +311,59 @@ void KApplicationTraderTest::testQueryByMimeType()
     checkResult(offers, ExpectedResult::NoResults);
 }
 
+static QStringList storageIds(const KService::List &services)
+{
+    QStringList ids;
+    for (const KService::Ptr &service : services) {
+        ids.append(service->storageId());
+    }
+    return ids;
+}
+
+void KApplicationTraderTest::testQueryByMimeTypes()
+{
+    const QStringList textPlain = storageIds(KApplicationTrader::queryByMimeType(QStringLiteral("text/plain")));
+    const QStringList imagePng = storageIds(KApplicationTrader::queryByMimeType(QStringLiteral("image/png")));
+    const QStringList schemeHandler = storageIds(KApplicationTrader::queryByMimeType(QStringLiteral("x-scheme-handler/someprotocol")));
+
+    // A single MIME type gives the same result as queryByMimeType, in the same order
+    QCOMPARE(storageIds(KApplicationTrader::queryByMimeTypes({QStringLiteral("text/plain")}, KApplicationTrader::MatchMode::Union)), textPlain);
+    QCOMPARE(storageIds(KApplicationTrader::queryByMimeTypes({QStringLiteral("text/plain")}, KApplicationTrader::MatchMode::Intersection)), textPlain);
+
+    // Union: every service once
+    const QStringList allMimeTypes{QStringLiteral("text/plain"), QStringLiteral("image/png"), QStringLiteral("x-scheme-handler/someprotocol")};
+    const QStringList unionIds = storageIds(KApplicationTrader::queryByMimeTypes(allMimeTypes, KApplicationTrader::MatchMode::Union));
+    QSet<QString> expectedUnion(textPlain.begin(), textPlain.end());
+    expectedUnion.unite(QSet<QString>(imagePng.begin(), imagePng.end()));
+    expectedUnion.unite(QSet<QString>(schemeHandler.begin(), schemeHandler.end()));
+    QCOMPARE(unionIds.size(), expectedUnion.size());
+    QCOMPARE(QSet<QString>(unionIds.begin(), unionIds.end()), expectedUnion);
+    // The preferred application of the first MIME type comes first
+    QCOMPARE(unionIds.first(), textPlain.first());
+
+    // Intersection: only services handling all the MIME types
+    const QStringList intersectionIds = storageIds(
+        KApplicationTrader::queryByMimeTypes({QStringLiteral("text/plain"), QStringLiteral("image/png")}, KApplicationTrader::MatchMode::Intersection));
+    QSet<QString> expectedIntersection(textPlain.begin(), textPlain.end());
+    expectedIntersection.intersect(QSet<QString>(imagePng.begin(), imagePng.end()));
+    QCOMPARE(QSet<QString>(intersectionIds.begin(), intersectionIds.end()), expectedIntersection);
+
+    const KService::List schemeAndText = KApplicationTrader::queryByMimeTypes({QStringLiteral("text/plain"), QStringLiteral("x-scheme-handler/someprotocol")},
+                                                                              KApplicationTrader::MatchMode::Intersection);
+    QCOMPARE(schemeAndText.size(), 1);
+    QCOMPARE(schemeAndText.first()->name(), QStringLiteral("FakeSchemeHandler"));
+
+    // FakeApplication doesn't handle the scheme
+    const KService::List none = KApplicationTrader::queryByMimeTypes({QStringLiteral("text/plain"), QStringLiteral("x-scheme-handler/someprotocol")},
+                                                                     KApplicationTrader::MatchMode::Intersection,
+                                                                     [](const KService::Ptr &serv) {
+                                                                         return serv->name() == QLatin1String("FakeApplication");
+                                                                     });
+    QVERIFY(none.isEmpty());
+
+    QVERIFY(KApplicationTrader::queryByMimeTypes({}, KApplicationTrader::MatchMode::Union).isEmpty());
+}
+
 QString KApplicationTraderTest::createFakeApplication(const QString &filename, const QString &name, const QMap<QString, QString> &extraFields)
 {
     const QString fakeService = QStandardPaths::writableLocation(QStandardPaths::ApplicationsLocation) + QLatin1Char('/') + filename;
@@ -0,0 +1,159 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <KConfigGroup>
+#include <KDesktopFile>
+#include <QFile>
+#include <QLocale>
+#include <QTemporaryDir>
+#include <QTest>
+#include <kdesktopentryreader_p.h>
+
+class KDesktopEntryReaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QLocale::setDefault(QLocale(QStringLiteral("de_CH")));
+        QVERIFY(m_tempDir.isValid());
+    }
+    void testValues();
+    void testTranslations();
+    void testActions();
+    void testUnsupported_data();
+    void testUnsupported();
+
+private:
+    QString writeFile(const QByteArray &contents);
+
+    QTemporaryDir m_tempDir;
+    int m_fileCount = 0;
+};
+
+QTEST_GUILESS_MAIN(KDesktopEntryReaderTest)
+
+QString KDesktopEntryReaderTest::writeFile(const QByteArray &contents)
+{
+    const QString fileName = m_tempDir.filePath(QStringLiteral("test%1.desktop").arg(++m_fileCount));
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+    file.write(contents);
+    return fileName;
+}
+
+void KDesktopEntryReaderTest::testValues()
+{
+    const QString fileName = writeFile(
+        "# comment\n"
+        "[Desktop Entry]\n"
+        "Type=Application\n"
+        "Name = Spaced  \n"
+        "Exec=foo\\s--bar %U\n"
+        "Comment=Tab\\there\\nnewline \\\\ backslash \\x41\n"
+        "MimeType=text/plain;text/semi\\;colon;\n"
+        "Terminal=false\n"
+        "NoDisplay=Off\n"
+        "StartupNotify=true\n"
+        "Exec=foo\\s--last %U\n");
+    QVERIFY(!fileName.isEmpty());
+
+    const KDesktopEntryReader reader(fileName);
+    QVERIFY(reader.isSupported());
+    const KDesktopEntryReader::Group group = reader.desktopGroup();
+
+    // Compare with KDesktopFile, which is the reference
+    const KDesktopFile desktopFile(fileName);
+    const KConfigGroup reference = desktopFile.desktopGroup();
+    QCOMPARE(group.entryMap(), reference.entryMap());
+    QCOMPARE(reader.readName(), desktopFile.readName());
+    QCOMPARE(group.readEntry("Exec"), QStringLiteral("foo --last %U"));
+    QCOMPARE(group.readEntry("Comment"), reference.readEntry("Comment"));
+    QCOMPARE(group.readXdgListEntry("MimeType"), reference.readXdgListEntry("MimeType"));
+    QCOMPARE(group.readXdgListEntry("MimeType"), (QStringList{QStringLiteral("text/plain"), QStringLiteral("text/semi;colon")}));
+    QCOMPARE(group.readEntry("Terminal", true), false);
+    QCOMPARE(group.readEntry("NoDisplay", true), false);
+    QCOMPARE(group.readEntry("StartupNotify", false), true);
+    QCOMPARE(group.readEntry("Missing", true), true);
+    QVERIFY(reader.tryExec());
+}
+
+void KDesktopEntryReaderTest::testTranslations()
+{
+    const QString fileName = writeFile(
+        "[Desktop Entry]\n"
+        "Name[de_CH]=Schweiz\n"
+        "Name=Untranslated\n"
+        "Name[de]=Deutsch\n"
+        "Name[fr]=Francais\n"
+        "GenericName[de]=Generisch\n"
+        "GenericName=Generic\n"
+        "Keywords[de]=eins;zwei;\n"
+        "Keywords=one;two;\n");
+
+    const KDesktopEntryReader reader(fileName);
+    QVERIFY(reader.isSupported());
+    const KDesktopEntryReader::Group group = reader.desktopGroup();
+
+    // lang_COUNTRY wins over lang, regardless of the order in the file
+    QCOMPARE(group.readEntry("Name"), QStringLiteral("Schweiz"));
+    QCOMPARE(group.readEntryUntranslated("Name"), QStringLiteral("Untranslated"));
+    QCOMPARE(group.readEntry("GenericName"), QStringLiteral("Generisch"));
+    QCOMPARE(group.readEntryUntranslated("GenericName"), QStringLiteral("Generic"));
+    QCOMPARE(group.readXdgListEntry("Keywords"), (QStringList{QStringLiteral("eins"), QStringLiteral("zwei")}));
+    // Other translations are not kept
+    QCOMPARE(group.entryMap().keys(), (QStringList{QStringLiteral("GenericName"), QStringLiteral("Keywords"), QStringLiteral("Name")}));
+}
+
+void KDesktopEntryReaderTest::testActions()
+{
+    const QString fileName = writeFile(
+        "[Desktop Entry]\n"
+        "Name=App\n"
+        "Actions=New;Missing;\n"
+        "\n"
+        "[Desktop Action New]\n"
+        "Name=New Window\n"
+        "Name[de]=Neues Fenster\n"
+        "Exec=app --new\n"
+        "X-Custom=value\n");
+
+    const KDesktopEntryReader reader(fileName);
+    QVERIFY(reader.isSupported());
+    QCOMPARE(reader.readActions(), (QStringList{QStringLiteral("New"), QStringLiteral("Missing")}));
+    QVERIFY(reader.hasActionGroup(QStringLiteral("New")));
+    QVERIFY(!reader.hasActionGroup(QStringLiteral("Missing")));
+
+    const KDesktopEntryReader::Group action = reader.actionGroup(QStringLiteral("New"));
+    QVERIFY(action.hasKey("Name"));
+    QCOMPARE(action.readEntry("Name"), QStringLiteral("Neues Fenster"));
+    QCOMPARE(action.readEntry("Exec"), QStringLiteral("app --new"));
+    QCOMPARE(action.entryMap().value(QStringLiteral("X-Custom")), QStringLiteral("value"));
+}
+
+void KDesktopEntryReaderTest::testUnsupported_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+
+    QTest::newRow("expansion") << QByteArray("[Desktop Entry]\nExec[$e]=$HOME/bin/app\n");
+    QTest::newRow("immutable group") << QByteArray("[Desktop Entry][$i]\nName=App\n");
+    QTest::newRow("authorize") << QByteArray("[Desktop Entry]\nName=App\nX-KDE-AuthorizeAction=shell_access\n");
+    QTest::newRow("tryexec path") << QByteArray("[Desktop Entry]\nName=App\nTryExec=~/bin/app\n");
+}
+
+void KDesktopEntryReaderTest::testUnsupported()
+{
+    QFETCH(QByteArray, contents);
+
+    const KDesktopEntryReader reader(writeFile(contents));
+    QVERIFY(!reader.isSupported());
+}
+
+#include "kdesktopentryreadertest.moc"
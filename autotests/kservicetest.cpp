@@ -484,6 +484,20 @@ void KServiceTest::testServiceActionService()
     const KServiceAction action = service.actions().first();
     QCOMPARE(action.service()->property<bool>(QStringLiteral("DBusActivatable")), true);
     QCOMPARE(action.service()->actions().size(), 2);
+
+    // The service clone is created once and shared by subsequent calls
+    QCOMPARE(service.actions().first().service().data(), action.service().data());
+
+    // ...until the service is modified
+    service.setExec(QStringLiteral("someOtherExec"));
+    const KServiceAction modifiedAction = service.actions().first();
+    QVERIFY(modifiedAction.service().data() != action.service().data());
+    QCOMPARE(modifiedAction.service()->exec(), QStringLiteral("someOtherExec"));
+
+    const QList<KServiceAction> actionsWithoutService = service.actions(KService::ActionsOption::WithoutService);
+    QCOMPARE(actionsWithoutService.size(), 2);
+    QCOMPARE(actionsWithoutService.first().name(), action.name());
+    QVERIFY(!actionsWithoutService.first().service());
 }
 
 void KServiceTest::testUntranslatedNames()
@@ -8,18 +8,36 @@
 #include <KConfigGroup>
 #include <KDesktopFile>
 #include <QDebug>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
 #include <QProcess>
+#include <QSet>
 #include <QSignalSpy>
 #include <QTemporaryDir>
 #include <QTest>
+#include <QTimer>
+#include <kapplicationtrader.h>
 #include <kbuildsycoca_p.h>
 #include <kservice.h>
 #include <kservicefactory_p.h>
 #include <ksycoca.h>
 #include <ksycoca_p.h>
+#include <ksycocacontenthash_p.h>
+#include <ksycocadelta_p.h>
+#include <ksycocadirectoryscan_p.h>
+#include <ksycocageneration_p.h>
+#include <ksycocamemfd_p.h>
+#include <ksycocaresourcewatcher_p.h>
+
+#include <algorithm>
 
 #ifdef Q_OS_UNIX
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <utime.h>
 #endif
 
@@ -73,7 +91,25 @@ private Q_SLOTS:
     void testDeletingSycoca();
     void testNonReadableSycoca();
     void extraFileInFutureShouldRebuildSycocaOnce();
+    void newDesktopMimeAppsListShouldRebuildSycoca();
     void testNoMenuFile();
+    void incrementalBuildShouldKeepUnchangedServices();
+    void changedAppShouldBeSavedAsDelta();
+    void incrementalBuildShouldReusePreviousBuild();
+    void backgroundRebuildShouldEmitDatabaseChanged();
+    void runningDaemonShouldBeLeftToRebuild();
+    void newAppShouldBeSeenByResourceWatcher();
+    void editedAppShouldBeSeenByResourceWatcher();
+    void rebuildShouldIncrementGeneration();
+    void memFdShouldMapDatabase();
+    void fileStrategyShouldFindServices();
+    void statisticsShouldCountLookups();
+    void traceFileShouldContainPhases();
+    void epochTimestampsShouldNotRebuildEveryTime();
+    void directoryStampShouldChangeWithEntries();
+    void parallelParsingShouldMatchSerialParsing();
+    void directoryScanShouldFollowEverySymlink();
+    void directoryScanShouldAskForReadability();
 
 private:
     void createTestApp()
@@ -100,6 +136,8 @@ private:
     }
 
     static void runKBuildSycoca(const QProcessEnvironment &environment, bool global = false);
+    static KSycocaResourceWatcher *upToDateResourceWatcher();
+    static bool waitForResourceChange(const KSycocaResourceWatcher *watcher, quint64 changeCount);
 
     QTemporaryDir m_tempDir;
 };
@@ -322,6 +360,40 @@ void KSycocaTest::extraFileInFutureShouldRebuildSycocaOnce()
     QVERIFY(QFile::remove(path));
 }
 
+void KSycocaTest::newDesktopMimeAppsListShouldRebuildSycoca()
+{
+    const QByteArray oldDesktop = qgetenv("XDG_CURRENT_DESKTOP");
+    qputenv("XDG_CURRENT_DESKTOP", "KSycocaTest");
+    const QString configDir = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    QVERIFY(QDir(configDir).exists());
+    const QString path = configDir + QLatin1String("/ksycocatest-mimeapps.list");
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    ksycoca_ms_between_checks = 0;
+    KSycoca::self()->ensureCacheValid();
+    KSycoca::self()->ensureCacheValid();
+
+    // The candidate files of the config dir are resolved and cached now
+    KSycocaPrivate *d = KSycocaPrivate::self();
+    QVERIFY(!d->currentExtraFiles().contains(path));
+    QVERIFY(!d->needsRebuild());
+
+    QTest::qWait(s_waitDelay);
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[Default Applications]\ntext/plain=org.kde.test.desktop\n");
+    }
+    QVERIFY(d->currentExtraFiles().contains(QFileInfo(path).canonicalFilePath()));
+    // Right away, or once the resource watcher noticed the new file
+    QTRY_VERIFY(d->needsRebuild());
+
+    QVERIFY(QFile::remove(path));
+    qputenv("XDG_CURRENT_DESKTOP", oldDesktop);
+}
+
 void KSycocaTest::testNoMenuFile()
 {
     // remove the menu file to force using the fallback
@@ -333,4 +405,724 @@ void KSycocaTest::testNoMenuFile()
     QVERIFY(builder.recreate());
 }
 
+void KSycocaTest::incrementalBuildShouldKeepUnchangedServices()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.unchanged.desktop");
+    {
+        KDesktopFile app(appPath);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "unchanged %f");
+        app.desktopGroup().writeEntry("Name", "Unchanged App");
+        app.desktopGroup().writeEntry("Actions", "Open;");
+        app.actionGroup(QStringLiteral("Open")).writeEntry("Name", "Open");
+        app.actionGroup(QStringLiteral("Open")).writeEntry("Exec", "unchanged --open");
+    }
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+
+    // The service is copied from the previous database by the incremental build
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(true));
+    }
+    ksycoca_ms_between_checks = 0;
+    const KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.unchanged"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Unchanged App"));
+    QCOMPARE(service->exec(), QStringLiteral("unchanged %f"));
+    const QList<KServiceAction> actions = service->actions();
+    QCOMPARE(actions.size(), 1);
+    QCOMPARE(actions.at(0).exec(), QStringLiteral("unchanged --open"));
+
+    QVERIFY(QFile::remove(appPath));
+}
+
+void KSycocaTest::changedAppShouldBeSavedAsDelta()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.deltatest.desktop");
+    const QString newAppPath = appsDir() + QLatin1String("org.kde.deltatest.new.desktop");
+    auto writeApp = [](const QString &path, const QString &name) {
+        KDesktopFile app(path);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "deltatest %f");
+        app.desktopGroup().writeEntry("Name", name);
+        app.desktopGroup().writeEntry("MimeType", "text/plain;");
+    };
+    writeApp(appPath, QStringLiteral("Delta App"));
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    const QString deltaPath = KSycocaDelta::filePath(KSycoca::absoluteFilePath());
+    QVERIFY(!QFile::exists(deltaPath));
+    const QDateTime databaseTimestamp = QFileInfo(KSycoca::absoluteFilePath()).lastModified();
+    ksycoca_ms_between_checks = 0;
+    QCOMPARE(KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest"))->name(), QStringLiteral("Delta App"));
+
+    auto buildDelta = [] {
+        KBuildSycoca builder;
+        builder.setDeltaUpdates(true);
+        return builder.recreate(true);
+    };
+    auto offersNewApp = [] {
+        const KService::List offers = KApplicationTrader::queryByMimeType(QStringLiteral("text/plain"));
+        return std::any_of(offers.cbegin(), offers.cend(), [](const KService::Ptr &offer) {
+            return offer->storageId() == QLatin1String("org.kde.deltatest.new.desktop");
+        });
+    };
+
+    // Modifying an existing app only writes a delta
+    QTest::qWait(s_waitDelay);
+    writeApp(appPath, QStringLiteral("Renamed Delta App"));
+    QVERIFY(buildDelta());
+    QVERIFY(QFile::exists(deltaPath));
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    KSycoca::self()->ensureCacheValid();
+    // The directory timestamps of the delta are used, so the database isn't rebuilt
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Renamed Delta App"));
+
+    // A new app is added to the delta, with its dictionary slots and offers
+    QTest::qWait(s_waitDelay);
+    writeApp(newAppPath, QStringLiteral("New Delta App"));
+    QVERIFY(buildDelta());
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    KSycoca::self()->ensureCacheValid();
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    service = KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest.new"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("New Delta App"));
+    KSycocaDelta delta;
+    QVERIFY(delta.load(KSycoca::absoluteFilePath(), databaseTimestamp.toMSecsSinceEpoch()));
+    QCOMPARE(delta.addedOffsets().size(), 1);
+    QVERIFY(KService::serviceByMenuId(QStringLiteral("org.kde.deltatest.new.desktop")));
+    QVERIFY(KService::serviceByDesktopPath(service->entryPath()));
+    QVERIFY(service->hasMimeType(QStringLiteral("text/plain")));
+    QVERIFY(offersNewApp());
+    const KService::List allServices = KService::allServices();
+    QVERIFY(std::any_of(allServices.cbegin(), allServices.cend(), [](const KService::Ptr &s) {
+        return s->storageId() == QLatin1String("org.kde.deltatest.new.desktop");
+    }));
+
+    // A new mimeapps.list only changes offer lists
+    const QString mimeAppsPath = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QLatin1String("/mimeapps.list");
+    QVERIFY(!QFile::exists(mimeAppsPath));
+    QTest::qWait(s_waitDelay);
+    {
+        KConfig mimeApps(mimeAppsPath, KConfig::SimpleConfig);
+        mimeApps.group(QStringLiteral("Removed Associations")).writeEntry("text/plain", QStringList{QStringLiteral("org.kde.deltatest.new.desktop")});
+    }
+    QVERIFY(buildDelta());
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    KSycoca::self()->ensureCacheValid();
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    QVERIFY(!offersNewApp());
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest.new")));
+    QVERIFY(QFile::remove(mimeAppsPath));
+
+    // A removed app is gone from the lookups
+    QTest::qWait(s_waitDelay);
+    QVERIFY(QFile::remove(appPath));
+    QVERIFY(buildDelta());
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+    KSycoca::self()->ensureCacheValid();
+    QVERIFY(!KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest")));
+    QVERIFY(!KService::serviceByMenuId(QStringLiteral("org.kde.deltatest.desktop")));
+    QVERIFY(offersNewApp());
+
+    // A full build compacts the delta into a new database
+    QTest::qWait(s_waitDelay);
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(true));
+    }
+    QVERIFY(!QFile::exists(deltaPath));
+    QVERIFY(QFileInfo(KSycoca::absoluteFilePath()).lastModified() > databaseTimestamp);
+    KSycoca::self()->ensureCacheValid();
+    service = KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest.new"));
+    QVERIFY(service);
+    QVERIFY(!KService::serviceByDesktopName(QStringLiteral("org.kde.deltatest")));
+
+    QVERIFY(QFile::remove(newAppPath));
+}
+
+void KSycocaTest::incrementalBuildShouldReusePreviousBuild() // what kbuildsycoca --daemon does
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.daemontest.desktop");
+    auto writeApp = [&appPath](const QString &name) {
+        KDesktopFile app(appPath);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "daemontest");
+        app.desktopGroup().writeEntry("Name", name);
+    };
+    writeApp(QStringLiteral("Daemon App"));
+    std::shared_ptr<const KBuildSycoca::BuildState> state;
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+        state = builder.buildState();
+    }
+    QVERIFY(state);
+
+    QTest::qWait(s_waitDelay);
+    writeApp(QStringLiteral("Renamed Daemon App"));
+    {
+        KBuildSycoca builder;
+        builder.setPreviousBuild(state);
+        QVERIFY(builder.recreate(true));
+        QVERIFY(builder.buildState());
+    }
+    ksycoca_ms_between_checks = 0;
+    KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.daemontest"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Renamed Daemon App"));
+    // The other apps were taken from the previous build
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.test")));
+
+    QVERIFY(QFile::remove(appPath));
+}
+
+void KSycocaTest::backgroundRebuildShouldEmitDatabaseChanged()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.backgroundtest.desktop");
+    KSycoca::self()->ensureCacheValid();
+    KSycoca::setBackgroundRebuildEnabled(true);
+    QSignalSpy spy(KSycoca::self(), &KSycoca::databaseChanged);
+
+    QTest::qWait(s_waitDelay);
+    {
+        KDesktopFile app(appPath);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "backgroundtest");
+        app.desktopGroup().writeEntry("Name", "Background App");
+    }
+    ksycoca_ms_between_checks = 0;
+    // Returns right away, the database is rebuilt in another thread
+    KSycoca::self()->ensureCacheValid();
+    QVERIFY(spy.wait(20000));
+    KSycoca::setBackgroundRebuildEnabled(false);
+
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.backgroundtest")));
+    QVERIFY(QFile::remove(appPath));
+}
+
+void KSycocaTest::runningDaemonShouldBeLeftToRebuild()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.daemonlocktest.desktop");
+    KSycoca::self()->ensureCacheValid();
+    const QDateTime databaseTimestamp = QFileInfo(KSycoca::absoluteFilePath()).lastModified();
+
+    // What kbuildsycoca --daemon holds
+    QLockFile daemonLock(KSycocaPrivate::daemonLockFilePath(KSycoca::absoluteFilePath()));
+    QVERIFY(daemonLock.tryLock(0));
+    QVERIFY(KSycocaPrivate::isDaemonRunning(KSycoca::absoluteFilePath()));
+
+    QTest::qWait(s_waitDelay);
+    {
+        KDesktopFile app(appPath);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "daemonlocktest");
+        app.desktopGroup().writeEntry("Name", "Daemon Lock App");
+    }
+    ksycoca_ms_between_checks = 0;
+    KSycoca::self()->ensureCacheValid();
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), databaseTimestamp);
+
+    // Without a daemon, the application rebuilds the database itself
+    daemonLock.unlock();
+    QVERIFY(!KSycocaPrivate::isDaemonRunning(KSycoca::absoluteFilePath()));
+    KSycoca::self()->ensureCacheValid();
+    QVERIFY(QFileInfo(KSycoca::absoluteFilePath()).lastModified() > databaseTimestamp);
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.daemonlocktest")));
+    QVERIFY(QFile::remove(appPath));
+}
+
+KSycocaResourceWatcher *KSycocaTest::upToDateResourceWatcher()
+{
+    ksycoca_ms_between_checks = 0;
+    KSycoca::self()->ensureCacheValid();
+    // Let the notifications for the database written by the previous tests arrive, until it's found up to date
+    QTest::qWait(200);
+    for (int i = 0; i < 50 && !KSycocaPrivate::self()->resourcesUnchanged(); ++i) {
+        KSycoca::self()->ensureCacheValid();
+        QTest::qWait(100);
+    }
+    return KSycocaPrivate::self()->resourcesUnchanged() ? KSycocaResourceWatcher::self() : nullptr;
+}
+
+// Runs an event loop, as an application does meanwhile, until the watcher saw a change
+bool KSycocaTest::waitForResourceChange(const KSycocaResourceWatcher *watcher, quint64 changeCount)
+{
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (watcher->changeCount() != changeCount) {
+            loop.quit();
+        }
+    });
+    poll.start(10);
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    loop.exec();
+    return watcher->changeCount() != changeCount;
+}
+
+void KSycocaTest::newAppShouldBeSeenByResourceWatcher()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.watchertest.desktop");
+    KSycocaResourceWatcher *watcher = upToDateResourceWatcher();
+    QVERIFY(watcher);
+
+    // Nothing changed, the timestamps aren't checked
+    const quint64 directoryChecks = KSycoca::statistics().value(KSycoca::Statistics::DirectoryChecks);
+    KSycoca::self()->ensureCacheValid();
+    QCOMPARE(KSycoca::statistics().value(KSycoca::Statistics::DirectoryChecks), directoryChecks);
+
+    const quint64 changeCount = watcher->changeCount();
+    {
+        KDesktopFile app(appPath);
+        app.desktopGroup().writeEntry("Type", "Application");
+        app.desktopGroup().writeEntry("Exec", "watchertest");
+        app.desktopGroup().writeEntry("Name", "Watcher App");
+    }
+
+    QVERIFY(waitForResourceChange(watcher, changeCount));
+    QVERIFY(!KSycocaPrivate::self()->resourcesUnchanged());
+    QCOMPARE(KSycoca::statistics().value(KSycoca::Statistics::DirectoryChecks), directoryChecks);
+
+    // The next call checks the timestamps and rebuilds
+    KSycoca::self()->ensureCacheValid();
+    QVERIFY(KSycoca::statistics().value(KSycoca::Statistics::DirectoryChecks) > directoryChecks);
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.watchertest")));
+    QVERIFY(QFile::remove(appPath));
+}
+
+void KSycocaTest::editedAppShouldBeSeenByResourceWatcher()
+{
+    const QString appPath = appsDir() + QLatin1String("org.kde.editedtest.desktop");
+    const auto writeApp = [&appPath](const QByteArray &name) {
+        // In place, keeping the inode, unlike KDesktopFile which writes a new file and renames it
+        QFile file(appPath);
+        return file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            && file.write("[Desktop Entry]\nType=Application\nExec=editedtest\nName=" + name + '\n') > 0;
+    };
+    QVERIFY(writeApp("Edited App"));
+    KSycocaResourceWatcher *watcher = upToDateResourceWatcher();
+    QVERIFY(watcher);
+    KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.editedtest"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Edited App"));
+
+    const quint64 changeCount = watcher->changeCount();
+    QTest::qWait(s_waitDelay);
+    QVERIFY(writeApp("Edited App Again"));
+    QVERIFY(waitForResourceChange(watcher, changeCount));
+    QVERIFY(!KSycocaPrivate::self()->resourcesUnchanged());
+
+    KSycoca::self()->ensureCacheValid();
+    service = KService::serviceByDesktopName(QStringLiteral("org.kde.editedtest"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Edited App Again"));
+    QVERIFY(QFile::remove(appPath));
+}
+
+void KSycocaTest::rebuildShouldIncrementGeneration()
+{
+#ifdef Q_OS_UNIX
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    KSycocaGeneration generation;
+    QVERIFY(generation.open(KSycoca::absoluteFilePath()));
+    const quint64 before = generation.current();
+    QVERIFY(before > 0);
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    // Seen through the existing mapping
+    QCOMPARE(generation.current(), before + 1);
+#else
+    QSKIP("This test requires mmap");
+#endif
+}
+
+void KSycocaTest::memFdShouldMapDatabase()
+{
+    if (!KSycocaMemFd::isSupported()) {
+        QSKIP("This test requires memfd");
+    }
+#ifdef Q_OS_UNIX
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    const QString path = KSycoca::absoluteFilePath();
+    const qint64 lastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    const int fd = KSycocaMemFd::publish(path);
+    QVERIFY(fd >= 0);
+
+    qint64 size = 0;
+    QVERIFY(!KSycocaMemFd::map(path, lastModified - 1, &size)); // for another database
+    const char *data = KSycocaMemFd::map(path, lastModified, &size);
+    QVERIFY(data);
+    QFile database(path);
+    QVERIFY(database.open(QIODevice::ReadOnly));
+    QCOMPARE(QByteArray(data, size), database.readAll());
+
+    munmap(const_cast<char *>(data), size);
+
+    // As if the handle file was for another database of the same mtime
+    QFile handleFile(KSycocaMemFd::handleFilePath(path));
+    QVERIFY(handleFile.open(QIODevice::ReadOnly));
+    QList<QByteArray> fields = handleFile.readAll().trimmed().split(' ');
+    handleFile.close();
+    QCOMPARE(fields.size(), 5);
+    fields[3] = QByteArray::number(fields.at(3).toLongLong() + 1);
+    QVERIFY(handleFile.open(QIODevice::WriteOnly));
+    handleFile.write(fields.join(' ') + '\n');
+    handleFile.close();
+    QVERIFY(!KSycocaMemFd::map(path, lastModified, &size));
+
+    // What kbuildsycoca --daemon does on exit
+    KSycocaMemFd::unpublish(path, fd);
+    QVERIFY(!QFile::exists(KSycocaMemFd::handleFilePath(path)));
+    ::close(fd);
+#endif
+}
+
+void KSycocaTest::fileStrategyShouldFindServices()
+{
+    KSycoca::self()->ensureCacheValid();
+    const int serviceCount = KService::allServices().count();
+    QVERIFY(serviceCount > 0);
+
+    // Read through the page cache of the file device, instead of the mmap'ed file
+    KSycocaPrivate::self()->closeDatabase();
+    KSycocaPrivate::self()->setStrategyFromString(QStringLiteral("file"));
+    QCOMPARE(KService::allServices().count(), serviceCount);
+    KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.test"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Test App"));
+    QVERIFY(!KService::serviceByDesktopName(QStringLiteral("org.kde.doesnotexist")));
+
+    KSycocaPrivate::self()->closeDatabase();
+    KSycocaPrivate::self()->setStrategyFromString(QStringLiteral("mmap"));
+}
+
+void KSycocaTest::statisticsShouldCountLookups()
+{
+    using Statistics = KSycoca::Statistics;
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.test")));
+    const Statistics before = KSycoca::statistics();
+
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.test")));
+    QVERIFY(!KService::serviceByDesktopName(QStringLiteral("org.kde.doesnotexist")));
+
+    const Statistics after = KSycoca::statistics();
+    QCOMPARE(after.probes(Statistics::ServicesByDesktopName), before.probes(Statistics::ServicesByDesktopName) + 2);
+    QCOMPARE(after.hits(Statistics::ServicesByDesktopName), before.hits(Statistics::ServicesByDesktopName) + 1);
+    QCOMPARE(after.misses(Statistics::ServicesByDesktopName), before.misses(Statistics::ServicesByDesktopName) + 1);
+    QVERIFY(after.decodedEntries(Statistics::ServiceEntry) > before.decodedEntries(Statistics::ServiceEntry));
+    QVERIFY(after.value(Statistics::DecodedBytes) > before.value(Statistics::DecodedBytes));
+    QVERIFY(after.value(Statistics::EnsureCacheValidCalls) >= before.value(Statistics::EnsureCacheValidCalls) + 2);
+    // A snapshot, which doesn't change afterwards
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.test")));
+    QCOMPARE(after.probes(Statistics::ServicesByDesktopName), before.probes(Statistics::ServicesByDesktopName) + 2);
+}
+
+void KSycocaTest::traceFileShouldContainPhases()
+{
+    const QString traceFile = m_tempDir.path() + QLatin1String("/trace.json");
+    QProcess proc;
+    proc.setProcessChannelMode(QProcess::ForwardedChannels);
+    proc.start(QStringLiteral(KBUILDSYCOCAEXE), {QStringLiteral("--testmode"), QStringLiteral("--noincremental"), QStringLiteral("--trace-file"), traceFile});
+    QVERIFY(proc.waitForFinished());
+    QCOMPARE(proc.exitStatus(), QProcess::NormalExit);
+    QCOMPARE(proc.exitCode(), 0);
+
+    QFile file(traceFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonDocument trace = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QSet<QString> names;
+    QStringList parsedFiles;
+    const QJsonArray events = trace.object().value(QLatin1String("traceEvents")).toArray();
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QLatin1String("ph")).toString() != QLatin1String("X")) {
+            continue;
+        }
+        QVERIFY(event.contains(QLatin1String("ts")));
+        QVERIFY(event.contains(QLatin1String("dur")));
+        const QString name = event.value(QLatin1String("name")).toString();
+        names.insert(name);
+        if (name == QLatin1String("parse file")) {
+            parsedFiles.append(event.value(QLatin1String("args")).toObject().value(QLatin1String("detail")).toString());
+        }
+    }
+    for (const char *phase : {"recreate", "directory scan", "VFolderMenu::parseMenu", "postProcessServices", "KSycocaDict::save", "QSaveFile::commit"}) {
+        QVERIFY2(names.contains(QLatin1String(phase)), phase);
+    }
+    QVERIFY2(std::any_of(parsedFiles.cbegin(),
+                         parsedFiles.cend(),
+                         [](const QString &file) {
+                             return file.endsWith(QLatin1String("org.kde.test.desktop"));
+                         }),
+             qPrintable(parsedFiles.join(QLatin1Char(' '))));
+}
+
+void KSycocaTest::epochTimestampsShouldNotRebuildEveryTime() // what ostree based systems do, e.g. Fedora Kinoite
+{
+#ifdef Q_OS_UNIX
+    const QString appPath = appsDir() + QLatin1String("org.kde.epochtest.desktop");
+    auto writeApp = [this, &appPath](const QString &name) {
+        {
+            KDesktopFile app(appPath);
+            app.desktopGroup().writeEntry("Type", "Application");
+            app.desktopGroup().writeEntry("Exec", "epochtest");
+            app.desktopGroup().writeEntry("Name", name);
+        }
+        struct utimbuf utbuf;
+        utbuf.actime = 0;
+        utbuf.modtime = 0;
+        return utime(QFile::encodeName(appPath).constData(), &utbuf) == 0 && utime(QFile::encodeName(appsDir()).constData(), &utbuf) == 0;
+    };
+    QVERIFY(writeApp(QStringLiteral("Epoch App")));
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    const QString contentHashPath = KSycocaContentHash::filePath(KSycoca::absoluteFilePath());
+    QVERIFY(QFile::exists(contentHashPath));
+    const QDateTime hashedTimestamp = QFileInfo(contentHashPath).lastModified();
+
+    // Same contents, nothing to hash again
+    QTest::qWait(s_waitDelay);
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(true));
+    }
+    QCOMPARE(QFileInfo(contentHashPath).lastModified(), hashedTimestamp);
+    const QDateTime builtTimestamp = QFileInfo(KSycoca::absoluteFilePath()).lastModified();
+    // Readers compute the stamps the database has, so they don't rebuild it
+    ksycoca_ms_between_checks = 0;
+    KSycoca::self()->ensureCacheValid();
+    KSycoca::self()->ensureCacheValid();
+    QCOMPARE(QFileInfo(KSycoca::absoluteFilePath()).lastModified(), builtTimestamp);
+    QVERIFY(KService::serviceByDesktopName(QStringLiteral("org.kde.epochtest")));
+
+    // Replaced by a new version, with the same modification time
+    QTest::qWait(s_waitDelay);
+    QVERIFY(writeApp(QStringLiteral("Replaced Epoch App")));
+    KSycoca::self()->ensureCacheValid();
+    QVERIFY(QFileInfo(KSycoca::absoluteFilePath()).lastModified() > builtTimestamp);
+    const KService::Ptr service = KService::serviceByDesktopName(QStringLiteral("org.kde.epochtest"));
+    QVERIFY(service);
+    QCOMPARE(service->name(), QStringLiteral("Replaced Epoch App"));
+
+    QVERIFY(QFile::remove(appPath));
+    QCOMPARE(utime(QFile::encodeName(appsDir()).constData(), nullptr), 0);
+#else
+    QSKIP("This test requires utime");
+#endif
+}
+
+void KSycocaTest::directoryStampShouldChangeWithEntries()
+{
+    // Recursive, like the services and menus dirs
+    const QString dir = m_tempDir.path() + QLatin1String("/stamptest");
+    QVERIFY(QDir().mkpath(dir + QLatin1String("/subdir")));
+    const qint64 stamp = KSycocaContentHash::directoryStamp(dir);
+    QVERIFY(KSycocaContentHash::isContentStamp(stamp));
+    QCOMPARE(KSycocaContentHash::directoryStamp(dir), stamp);
+
+    // The change time has a granularity of a jiffy on some filesystems
+    QTest::qWait(s_waitDelay);
+    QFile file(dir + QLatin1String("/subdir/new.desktop"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+    const qint64 newStamp = KSycocaContentHash::directoryStamp(dir);
+    QVERIFY(newStamp != stamp);
+
+    // Reading a file doesn't change anything
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    file.readAll();
+    file.close();
+    QCOMPARE(KSycocaContentHash::directoryStamp(dir), newStamp);
+
+    QTest::qWait(s_waitDelay);
+    QVERIFY(file.remove());
+    QVERIFY(KSycocaContentHash::directoryStamp(dir) != newStamp);
+    QVERIFY(QDir(dir).removeRecursively());
+}
+
+void KSycocaTest::parallelParsingShouldMatchSerialParsing()
+{
+    // Enough files for preparseServices() to use threads
+    const QString dir = appsDir() + QLatin1String("parallel/");
+    QVERIFY(QDir().mkpath(dir));
+    for (int i = 0; i < 100; ++i) {
+        KDesktopFile app(dir + QStringLiteral("org.kde.parallel%1.desktop").arg(i));
+        KConfigGroup group = app.desktopGroup();
+        group.writeEntry("Type", "Application");
+        group.writeEntry("Name", QStringLiteral("Parallel App %1").arg(i));
+        group.writeEntry("Exec", QStringLiteral("parallel%1 %f").arg(i));
+        group.writeXdgListEntry("MimeType", {QStringLiteral("text/plain"), QStringLiteral("application/x-parallel%1").arg(i % 7)});
+        if (i % 3 == 0) {
+            group.writeEntry("Actions", "New;");
+            app.actionGroup(QStringLiteral("New")).writeEntry("Name", "New Window");
+            app.actionGroup(QStringLiteral("New")).writeEntry("Exec", QStringLiteral("parallel%1 --new").arg(i));
+        }
+        if (i % 10 == 9) {
+            group.writeEntry("Hidden", true);
+        }
+    }
+
+    const auto describe = [] {
+        QStringList result;
+        const KService::List services = KService::allServices();
+        for (const KService::Ptr &service : services) {
+            QStringList actions;
+            const QList<KServiceAction> serviceActions = service->actions(KService::ActionsOption::WithoutService);
+            for (const KServiceAction &action : serviceActions) {
+                actions << action.name() + QLatin1Char('=') + action.exec();
+            }
+            result << QStringList{service->storageId(),
+                                  service->menuId(),
+                                  service->entryPath(),
+                                  service->name(),
+                                  service->exec(),
+                                  service->mimeTypes().join(QLatin1Char(',')),
+                                  actions.join(QLatin1Char(','))}
+                          .join(QLatin1Char('|'));
+        }
+        result.sort();
+        // In order of preference
+        for (const QString &mimeType : {QStringLiteral("text/plain"), QStringLiteral("application/x-parallel3")}) {
+            QStringList offers;
+            const KService::List services = KApplicationTrader::queryByMimeType(mimeType);
+            for (const KService::Ptr &service : services) {
+                offers << service->storageId();
+            }
+            result << mimeType + QLatin1Char(':') + offers.join(QLatin1Char(','));
+        }
+        return result;
+    };
+
+    ksycoca_ms_between_checks = 0;
+    {
+        KBuildSycoca builder;
+        builder.setParallelParsing(false);
+        QVERIFY(builder.recreate(false));
+    }
+    const QStringList serial = describe();
+    QCOMPARE(std::count_if(serial.cbegin(),
+                           serial.cend(),
+                           [](const QString &service) {
+                               return service.startsWith(QLatin1String("parallel-org.kde.parallel"));
+                           }),
+             90);
+
+    QTest::qWait(s_waitDelay);
+    {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+    QCOMPARE(describe(), serial);
+
+    QVERIFY(QDir(dir).removeRecursively());
+}
+
+void KSycocaTest::directoryScanShouldFollowEverySymlink()
+{
+#ifdef Q_OS_UNIX
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(QDir().mkpath(root.filePath(QStringLiteral("real/sub"))));
+    QVERIFY(QFile(root.filePath(QStringLiteral("real/sub/app.desktop"))).open(QIODevice::WriteOnly));
+    // The same directory through two links, and a loop
+    QVERIFY(QFile::link(QStringLiteral("real"), root.filePath(QStringLiteral("link1"))));
+    QVERIFY(QFile::link(QStringLiteral("real"), root.filePath(QStringLiteral("link2"))));
+    QVERIFY(QFile::link(QStringLiteral(".."), root.filePath(QStringLiteral("real/up"))));
+
+    KSycocaDirectoryScan scan;
+    scan.scan({root.path()});
+    const KSycocaDirectoryScan::Entry *app = scan.entry(root.filePath(QStringLiteral("real/sub/app.desktop")));
+    QVERIFY(app);
+    QVERIFY(app->inode != 0);
+    for (const char *path : {"real/sub/app.desktop", "link1/sub/app.desktop", "link2/sub/app.desktop"}) {
+        const KSycocaDirectoryScan::Entry *entry = scan.entry(root.filePath(QLatin1String(path)));
+        QVERIFY2(entry, path);
+        QVERIFY(entry->isFile);
+        // The identity of the target, which the cache of content hashes is keyed on
+        QCOMPARE(entry->inode, app->inode);
+        QCOMPARE(entry->ctimeNSecs, app->ctimeNSecs);
+    }
+    const KSycocaDirectoryScan::Entry *link = scan.entry(root.filePath(QStringLiteral("link2")));
+    QVERIFY(link);
+    QVERIFY(link->isDir);
+    QVERIFY(link->isSymLink);
+
+    // The loop is listed, but not followed
+    const KSycocaDirectoryScan::Entry *up = scan.entry(root.filePath(QStringLiteral("real/up")));
+    QVERIFY(up);
+    QVERIFY(up->isSymLink);
+    QVERIFY(up->children.isEmpty());
+    QVERIFY(!scan.contains(root.filePath(QStringLiteral("real/up/real"))));
+
+    QStringList relPaths = scan.relativePaths(root.path());
+    relPaths.sort();
+    const QStringList expected{
+        QStringLiteral("link1"),
+        QStringLiteral("link1/sub"),
+        QStringLiteral("link1/sub/app.desktop"),
+        QStringLiteral("link1/up"),
+        QStringLiteral("link2"),
+        QStringLiteral("link2/sub"),
+        QStringLiteral("link2/sub/app.desktop"),
+        QStringLiteral("link2/up"),
+        QStringLiteral("real"),
+        QStringLiteral("real/sub"),
+        QStringLiteral("real/sub/app.desktop"),
+        QStringLiteral("real/up"),
+    };
+    QCOMPARE(relPaths, expected);
+#else
+    QSKIP("This test requires symlinks");
+#endif
+}
+
+void KSycocaTest::directoryScanShouldAskForReadability()
+{
+#ifdef Q_OS_UNIX
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    const QString readable = root.filePath(QStringLiteral("readable.desktop"));
+    const QString unreadable = root.filePath(QStringLiteral("unreadable.desktop"));
+    QVERIFY(QFile(readable).open(QIODevice::WriteOnly));
+    QVERIFY(QFile(unreadable).open(QIODevice::WriteOnly));
+    QVERIFY(QFile::setPermissions(unreadable, QFileDevice::WriteOwner));
+
+    KSycocaDirectoryScan scan;
+    scan.scan({root.path()});
+    // Same answer as the kernel, whatever the permission bits say (root, ACLs...)
+    for (const QString &path : {readable, unreadable}) {
+        const KSycocaDirectoryScan::Entry *entry = scan.entry(path);
+        QVERIFY(entry);
+        QCOMPARE(entry->readable, access(QFile::encodeName(path).constData(), R_OK) == 0);
+        QCOMPARE(entry->readable, QFileInfo(path).isReadable());
+    }
+    QVERIFY(scan.entry(readable)->readable);
+#else
+    QSKIP("The directory scan is only implemented on Unix");
+#endif
+}
+
 #include "ksycocatest.moc"
@@ -0,0 +1,100 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef BENCHMARK_APPS_H
+#define BENCHMARK_APPS_H
+
+#include <KConfigGroup>
+#include <KDesktopFile>
+#include <kbuildsycoca_p.h>
+#include <kservice.h>
+#include <ksycoca.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+#include <iterator>
+
+// Number of applications to create, can be overridden with KSYCOCA_BENCHMARK_APPS.
+// Alternatively, KSYCOCA_BENCHMARK_ROOT can point to a tree created by tests/ksycoca_datagen.
+static const int s_defaultBenchmarkAppCount = 1000;
+
+static void createBenchmarkApp(const QString &appsDir, int i)
+{
+    static const char *const categories[] = {"Utility", "Development", "Graphics", "Office", "Network", "AudioVideo", "Game", "System"};
+
+    // Every tenth application is in a subdirectory, so its menu id is "kde-org.kde.benchN.desktop"
+    const QString subdir = i % 10 == 0 ? QStringLiteral("kde/") : QString();
+    KDesktopFile file(appsDir + subdir + QStringLiteral("org.kde.bench%1.desktop").arg(i));
+    KConfigGroup group = file.desktopGroup();
+    group.writeEntry("Type", "Application");
+    group.writeEntry("Name", QStringLiteral("Benchmark App %1").arg(i));
+    group.writeEntry("Exec", QStringLiteral("bench%1 %f").arg(i));
+    group.writeEntry("Categories", QStringLiteral("%1;").arg(QLatin1String(categories[i % std::size(categories)])));
+
+    // text/plain is handled by half of the applications, image/png by a fifth
+    QStringList mimeTypes{QStringLiteral("application/x-bench%1").arg(i % 50)};
+    if (i % 2 == 0) {
+        mimeTypes << QStringLiteral("text/plain");
+    }
+    if (i % 5 == 0) {
+        mimeTypes << QStringLiteral("image/png");
+    }
+    group.writeXdgListEntry("MimeType", mimeTypes);
+}
+
+// Points the XDG dirs to the applications the benchmarks use, creating them in tempDir
+// unless KSYCOCA_BENCHMARK_ROOT is set. Call QStandardPaths::setTestModeEnabled(true) first.
+static bool setupBenchmarkApps(const QString &tempDir)
+{
+    // Only our applications, so that the numbers don't depend on what's installed.
+    // QMimeDatabase falls back to its built-in database.
+    const QString root = qEnvironmentVariable("KSYCOCA_BENCHMARK_ROOT");
+    if (!root.isEmpty()) {
+        // The layout written by ksycoca_datagen, whose applications.menu must win over the test one
+        qputenv("XDG_DATA_DIRS", QFile::encodeName(root + QLatin1String("/data-user:") + root + QLatin1String("/data-local:") + root + QLatin1String("/data-system")));
+        qputenv("XDG_CONFIG_DIRS", QFile::encodeName(root + QLatin1String("/config")));
+        QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QLatin1String("/menus/applications.menu"));
+        return true;
+    }
+
+    qputenv("XDG_DATA_DIRS", QFile::encodeName(tempDir));
+    qputenv("XDG_CONFIG_DIRS", QFile::encodeName(tempDir));
+    KSycoca::setupTestMenu();
+
+    const int appCount = qEnvironmentVariableIsSet("KSYCOCA_BENCHMARK_APPS") ? qEnvironmentVariableIntValue("KSYCOCA_BENCHMARK_APPS") : s_defaultBenchmarkAppCount;
+    const QString appsDir = tempDir + QLatin1String("/applications/");
+    if (!QDir().mkpath(appsDir + QLatin1String("kde"))) {
+        return false;
+    }
+    for (int i = 0; i < appCount; ++i) {
+        createBenchmarkApp(appsDir, i);
+    }
+    qDebug() << "Created" << appCount << "applications in" << appsDir;
+    return true;
+}
+
+// Builds the database of the applications set up by setupBenchmarkApps(), and returns their entry paths,
+// or an empty list on error
+[[maybe_unused]] static QStringList buildBenchmarkDatabase()
+{
+    KBuildSycoca builder;
+    if (!builder.recreate(false)) {
+        return {};
+    }
+    QStringList entryPaths;
+    const KService::List services = KService::allServices();
+    entryPaths.reserve(services.size());
+    for (const KService::Ptr &service : services) {
+        entryPaths.append(service->entryPath());
+    }
+    return entryPaths;
+}
+
+#endif
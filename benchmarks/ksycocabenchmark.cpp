@@ -0,0 +1,217 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QTest>
+
+#include <kapplicationtrader.h>
+#include <kbuildsycoca_p.h>
+#include <kservice.h>
+#include <kservicegroup.h>
+#include <ksycoca.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+#include "benchmarkapps.h"
+
+class KSycocaBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void serviceByDesktopName_data();
+    void serviceByDesktopName();
+    void serviceByMenuId_data();
+    void serviceByMenuId();
+    void serviceByStorageId_data();
+    void serviceByStorageId();
+    void queryByMimeType_data();
+    void queryByMimeType();
+    void preferredService();
+    void allServices();
+    void serviceGroupEntries();
+
+    // Last, they replace the database the lookups above use
+    void fullRebuild();
+    void incrementalRebuild();
+
+private:
+    QTemporaryDir m_tempDir;
+    int m_appCount = 0;
+    KService::Ptr m_hit; // an application in the middle of the database, for the lookups
+};
+
+QTEST_MAIN(KSycocaBenchmark)
+
+void KSycocaBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_tempDir.isValid());
+
+    QVERIFY(setupBenchmarkApps(m_tempDir.path()));
+
+    KBuildSycoca builder;
+    QVERIFY(builder.recreate(false));
+
+    KService::List services = KService::allServices();
+    QVERIFY(!services.isEmpty());
+    m_appCount = services.count();
+    std::sort(services.begin(), services.end(), [](const KService::Ptr &a, const KService::Ptr &b) {
+        return a->entryPath() < b->entryPath();
+    });
+    m_hit = services.at(services.count() / 2);
+    qDebug() << "Looking up" << m_hit->entryPath() << "among" << m_appCount << "applications";
+}
+
+void KSycocaBenchmark::cleanupTestCase()
+{
+    QFile::remove(KSycoca::absoluteFilePath());
+}
+
+void KSycocaBenchmark::serviceByDesktopName_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("found");
+
+    QTest::newRow("hit") << m_hit->desktopEntryName() << true;
+    QTest::newRow("miss") << QStringLiteral("org.kde.nosuchapp") << false;
+}
+
+void KSycocaBenchmark::serviceByDesktopName()
+{
+    QFETCH(QString, name);
+    QFETCH(bool, found);
+
+    QBENCHMARK {
+        const KService::Ptr service = KService::serviceByDesktopName(name);
+        QCOMPARE(bool(service), found);
+    }
+}
+
+void KSycocaBenchmark::serviceByMenuId_data()
+{
+    QTest::addColumn<QString>("menuId");
+    QTest::addColumn<bool>("found");
+
+    QTest::newRow("hit") << m_hit->menuId() << true;
+    QTest::newRow("miss") << QStringLiteral("kde-org.kde.nosuchapp.desktop") << false;
+}
+
+void KSycocaBenchmark::serviceByMenuId()
+{
+    QFETCH(QString, menuId);
+    QFETCH(bool, found);
+
+    QBENCHMARK {
+        const KService::Ptr service = KService::serviceByMenuId(menuId);
+        QCOMPARE(bool(service), found);
+    }
+}
+
+void KSycocaBenchmark::serviceByStorageId_data()
+{
+    QTest::addColumn<QString>("storageId");
+    QTest::addColumn<bool>("found");
+
+    // serviceByStorageId tries the menu id, the entry path, an absolute file and the desktop name, in that order
+    QTest::newRow("menu id") << m_hit->menuId() << true;
+    QTest::newRow("entry path") << m_hit->entryPath() << true;
+    QTest::newRow("desktop name") << m_hit->desktopEntryName() << true;
+    QTest::newRow("miss") << QStringLiteral("org.kde.nosuchapp.desktop") << false;
+}
+
+void KSycocaBenchmark::serviceByStorageId()
+{
+    QFETCH(QString, storageId);
+    QFETCH(bool, found);
+
+    QBENCHMARK {
+        const KService::Ptr service = KService::serviceByStorageId(storageId);
+        QCOMPARE(bool(service), found);
+    }
+}
+
+void KSycocaBenchmark::queryByMimeType_data()
+{
+    QTest::addColumn<QString>("mimeType");
+
+    QTest::newRow("text/plain") << QStringLiteral("text/plain"); // half of the applications
+    QTest::newRow("image/png") << QStringLiteral("image/png"); // a fifth
+    QTest::newRow("few") << QStringLiteral("application/x-bench7");
+    QTest::newRow("none") << QStringLiteral("application/x-nosuchtype");
+}
+
+void KSycocaBenchmark::queryByMimeType()
+{
+    QFETCH(QString, mimeType);
+
+    QBENCHMARK {
+        const KService::List services = KApplicationTrader::queryByMimeType(mimeType);
+        Q_UNUSED(services);
+    }
+}
+
+void KSycocaBenchmark::preferredService()
+{
+    QBENCHMARK {
+        QVERIFY(KApplicationTrader::preferredService(QStringLiteral("text/plain")));
+    }
+}
+
+void KSycocaBenchmark::allServices()
+{
+    QBENCHMARK {
+        QCOMPARE(KService::allServices().count(), m_appCount);
+    }
+}
+
+void KSycocaBenchmark::serviceGroupEntries()
+{
+    QBENCHMARK {
+        const KServiceGroup::Ptr root = KServiceGroup::root();
+        QVERIFY(root);
+        const KServiceGroup::List entries = root->entries(true, true);
+        Q_UNUSED(entries);
+    }
+}
+
+void KSycocaBenchmark::fullRebuild()
+{
+    QBENCHMARK {
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(false));
+    }
+}
+
+void KSycocaBenchmark::incrementalRebuild()
+{
+    // One application changed since the previous build
+    const QString path = QStandardPaths::locate(QStandardPaths::ApplicationsLocation, m_hit->entryPath());
+    QVERIFY(!path.isEmpty());
+    QDateTime mtime = QFileInfo(path).lastModified();
+
+    QBENCHMARK {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        mtime = mtime.addSecs(1);
+        QVERIFY(file.setFileTime(mtime, QFileDevice::FileModificationTime));
+        file.close();
+
+        KBuildSycoca builder;
+        QVERIFY(builder.recreate(true));
+    }
+}
+
+#include "ksycocabenchmark.moc"
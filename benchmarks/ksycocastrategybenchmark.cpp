@@ -0,0 +1,265 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QTest>
+
+#include <kapplicationtrader.h>
+#include <kservice.h>
+#include <ksycoca.h>
+#include <ksycoca_p.h>
+#include <ksycocamemfd_p.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "benchmarkapps.h"
+
+// Each round reopens the database and does the same work
+static const int s_rounds = 20;
+static const int s_lookupsPerRound = 200;
+
+/*
+ * Compares the ways of reading the database (the "strategy" key of the [KSycoca] group in kdeglobals),
+ * with the same workload: opening the database, single lookups and decoding all services.
+ *
+ * "cold" drops the database from the page cache before every round (posix_fadvise(DONTNEED), Linux only),
+ * which has no effect on "sharedmem" and "memfd", whose copies of the database live in memory.
+ * "warm" keeps it in the page cache.
+ *
+ * Latency percentiles and the page faults of each round are printed at the end.
+ */
+class KSycocaStrategyBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void workload_data();
+    void workload();
+
+private:
+    struct Result {
+        QString name;
+        std::vector<qint64> openNSecs;
+        std::vector<qint64> lookupNSecs;
+        std::vector<qint64> allServicesNSecs;
+        qint64 minorFaults = 0;
+        qint64 majorFaults = 0;
+        qint64 blockInputs = 0;
+    };
+
+    void dropFromPageCache();
+
+    QTemporaryDir m_tempDir;
+    QString m_databasePath;
+    QStringList m_entryPaths;
+    int m_memFd = -1;
+    QList<Result> m_results;
+};
+
+QTEST_MAIN(KSycocaStrategyBenchmark)
+
+namespace
+{
+struct Usage {
+    qint64 minorFaults = 0;
+    qint64 majorFaults = 0;
+    qint64 blockInputs = 0;
+};
+
+Usage currentUsage()
+{
+    Usage usage;
+#ifdef Q_OS_UNIX
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.minorFaults = ru.ru_minflt;
+        usage.majorFaults = ru.ru_majflt;
+        usage.blockInputs = ru.ru_inblock;
+    }
+#endif
+    return usage;
+}
+
+qint64 percentile(std::vector<qint64> samples, int percent)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples.at(std::min(samples.size() - 1, samples.size() * percent / 100));
+}
+}
+
+void KSycocaStrategyBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_tempDir.isValid());
+    QVERIFY(setupBenchmarkApps(m_tempDir.path()));
+
+    m_entryPaths = buildBenchmarkDatabase();
+    QVERIFY(!m_entryPaths.isEmpty());
+    m_databasePath = KSycoca::absoluteFilePath();
+
+    // What kbuildsycoca6 --daemon does for the readers
+    if (KSycocaMemFd::isSupported()) {
+        m_memFd = KSycocaMemFd::publish(m_databasePath);
+    }
+    qDebug() << "Reading" << m_databasePath << "of" << QFileInfo(m_databasePath).size() << "bytes, with" << m_entryPaths.count() << "applications";
+}
+
+void KSycocaStrategyBenchmark::cleanupTestCase()
+{
+    KSycocaPrivate::self()->closeDatabase();
+    KSycocaPrivate::self()->setStrategyFromString(QStringLiteral("mmap"));
+
+    const auto ms = [](qint64 ns) {
+        return QString::number(ns / 1e6, 'f', 3);
+    };
+    const auto us = [](qint64 ns) {
+        return QString::number(ns / 1e3, 'f', 1);
+    };
+    qInfo().noquote() << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+                             .arg(QStringLiteral("strategy"), -16)
+                             .arg(QStringLiteral("open ms"), 9)
+                             .arg(QStringLiteral("lookup p50 us"), 14)
+                             .arg(QStringLiteral("p90"), 8)
+                             .arg(QStringLiteral("p99"), 8)
+                             .arg(QStringLiteral("max"), 8)
+                             .arg(QStringLiteral("allServices ms"), 15)
+                             .arg(QStringLiteral("faults min/maj"), 15)
+                             .arg(QStringLiteral("inblock"), 8);
+    for (const Result &result : std::as_const(m_results)) {
+        qInfo().noquote() << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+                                 .arg(result.name, -16)
+                                 .arg(ms(percentile(result.openNSecs, 50)), 9)
+                                 .arg(us(percentile(result.lookupNSecs, 50)), 14)
+                                 .arg(us(percentile(result.lookupNSecs, 90)), 8)
+                                 .arg(us(percentile(result.lookupNSecs, 99)), 8)
+                                 .arg(us(percentile(result.lookupNSecs, 100)), 8)
+                                 .arg(ms(percentile(result.allServicesNSecs, 50)), 15)
+                                 .arg(QStringLiteral("%1/%2").arg(result.minorFaults / s_rounds).arg(result.majorFaults / s_rounds), 15)
+                                 .arg(result.blockInputs / s_rounds, 8);
+    }
+    qInfo() << "(medians, and page faults and block inputs per round)";
+
+#ifdef Q_OS_UNIX
+    if (m_memFd != -1) {
+        close(m_memFd);
+        QFile::remove(KSycocaMemFd::handleFilePath(m_databasePath));
+    }
+#endif
+    QFile::remove(m_databasePath);
+}
+
+void KSycocaStrategyBenchmark::workload_data()
+{
+    QTest::addColumn<QString>("strategy");
+    QTest::addColumn<bool>("cold");
+
+    QStringList strategies{QStringLiteral("mmap"), QStringLiteral("file")};
+#ifndef QT_NO_SHAREDMEMORY
+    strategies << QStringLiteral("sharedmem");
+#endif
+    if (KSycocaMemFd::isSupported()) {
+        strategies << QStringLiteral("memfd");
+    }
+    for (const QString &strategy : std::as_const(strategies)) {
+        QTest::addRow("%s/cold", qPrintable(strategy)) << strategy << true;
+        QTest::addRow("%s/warm", qPrintable(strategy)) << strategy << false;
+    }
+}
+
+void KSycocaStrategyBenchmark::dropFromPageCache()
+{
+#ifdef Q_OS_LINUX
+    QFile file(m_databasePath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED), 0);
+#endif
+}
+
+void KSycocaStrategyBenchmark::workload()
+{
+    QFETCH(QString, strategy);
+    QFETCH(bool, cold);
+    if (strategy == QLatin1String("memfd") && m_memFd < 0) {
+        // Otherwise it would silently measure the file strategy it falls back to
+        QSKIP("Couldn't publish the database in a memfd");
+    }
+#ifndef Q_OS_LINUX
+    if (cold) {
+        QSKIP("Dropping a file from the page cache requires posix_fadvise");
+    }
+#endif
+
+    Result result;
+    result.name = QStringLiteral("%1/%2").arg(strategy, cold ? QStringLiteral("cold") : QStringLiteral("warm"));
+    const QStringList mimeTypes{QStringLiteral("text/plain"), QStringLiteral("image/png"), QStringLiteral("application/x-bench7")};
+    std::vector<qint64> roundNSecs;
+
+    for (int round = 0; round < s_rounds; ++round) {
+        // Unmapped, so that the kernel can drop the pages
+        KSycocaPrivate::self()->closeDatabase();
+        KSycocaPrivate::self()->setStrategyFromString(strategy);
+        if (cold) {
+            dropFromPageCache();
+            if (QTest::currentTestFailed()) {
+                return;
+            }
+        }
+
+        const Usage before = currentUsage();
+        QElapsedTimer roundTimer;
+        roundTimer.start();
+        QElapsedTimer timer;
+
+        // Opening the database (and its factories) happens in the first lookup
+        timer.start();
+        QVERIFY(KService::serviceByDesktopPath(m_entryPaths.first()));
+        result.openNSecs.push_back(timer.nsecsElapsed());
+
+        for (int i = 0; i < s_lookupsPerRound; ++i) {
+            timer.start();
+            if (i % 4 == 3) {
+                QVERIFY(!KApplicationTrader::queryByMimeType(mimeTypes.at(i % mimeTypes.count())).isEmpty());
+            } else {
+                QVERIFY(KService::serviceByDesktopPath(m_entryPaths.at((round * 7919 + i * 31) % m_entryPaths.count())));
+            }
+            result.lookupNSecs.push_back(timer.nsecsElapsed());
+        }
+
+        timer.start();
+        QCOMPARE(KService::allServices().count(), m_entryPaths.count());
+        result.allServicesNSecs.push_back(timer.nsecsElapsed());
+
+        roundNSecs.push_back(roundTimer.nsecsElapsed());
+        const Usage after = currentUsage();
+        result.minorFaults += after.minorFaults - before.minorFaults;
+        result.majorFaults += after.majorFaults - before.majorFaults;
+        result.blockInputs += after.blockInputs - before.blockInputs;
+    }
+
+    QTest::setBenchmarkResult(percentile(roundNSecs, 50) / 1e6, QTest::WalltimeMilliseconds);
+    m_results.append(result);
+}
+
+#include "ksycocastrategybenchmark.moc"
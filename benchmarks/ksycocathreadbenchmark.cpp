@@ -0,0 +1,200 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QTest>
+
+#include <kapplicationtrader.h>
+#include <kservice.h>
+#include <ksycoca.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "benchmarkapps.h"
+
+// Lookups per thread, so that the ideal curve is flat: N threads doing N times the work in the same time
+static const int s_desktopPathLookups = 4000;
+static const int s_mimeTypeQueries = 200;
+static const int s_allServicesCalls = 4;
+
+static const int s_threadCounts[] = {1, 2, 4, 8, 16, 32};
+
+enum Workload {
+    ServiceByDesktopPath,
+    QueryByMimeType,
+    AllServices,
+};
+
+/*
+ * Measures how lookups scale with threads: each iteration starts new threads which all do the same
+ * number of lookups. Since KSycoca is per thread, this includes opening the database in each of them,
+ * the duration of that first call is reported separately.
+ *
+ * The scaling curve (lookups per second, speedup and efficiency per thread count) is printed at the end.
+ */
+class KSycocaThreadBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void lookups_data();
+    void lookups();
+
+private:
+    struct Result {
+        qint64 nsecs = -1; // best iteration
+        qint64 firstCallNSecs = 0; // average over the threads of that iteration
+        qint64 calls = 0;
+    };
+
+    QTemporaryDir m_tempDir;
+    QStringList m_entryPaths;
+    QMap<Workload, QMap<int, Result>> m_results;
+};
+
+QTEST_MAIN(KSycocaThreadBenchmark)
+
+static const char *workloadName(Workload workload)
+{
+    switch (workload) {
+    case ServiceByDesktopPath:
+        return "serviceByDesktopPath";
+    case QueryByMimeType:
+        return "queryByMimeType";
+    case AllServices:
+        return "allServices";
+    }
+    return "";
+}
+
+void KSycocaThreadBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_tempDir.isValid());
+    QVERIFY(setupBenchmarkApps(m_tempDir.path()));
+
+    m_entryPaths = buildBenchmarkDatabase();
+    QVERIFY(!m_entryPaths.isEmpty());
+    qDebug() << "Looking up" << m_entryPaths.count() << "applications with up to" << QThread::idealThreadCount() << "cores";
+}
+
+void KSycocaThreadBenchmark::cleanupTestCase()
+{
+    for (auto it = m_results.cbegin(); it != m_results.cend(); ++it) {
+        const Result single = it->value(1);
+        qInfo().noquote() << QStringLiteral("%1:").arg(QLatin1String(workloadName(it.key())));
+        qInfo().noquote() << QStringLiteral("%1 %2 %3 %4 %5")
+                                 .arg(QStringLiteral("threads"), 8)
+                                 .arg(QStringLiteral("calls/s"), 14)
+                                 .arg(QStringLiteral("speedup"), 10)
+                                 .arg(QStringLiteral("efficiency"), 12)
+                                 .arg(QStringLiteral("first call ms"), 15);
+        for (auto resultIt = it->cbegin(); resultIt != it->cend(); ++resultIt) {
+            const int threads = resultIt.key();
+            const Result &result = resultIt.value();
+            const double perSecond = result.calls * 1e9 / std::max<qint64>(result.nsecs, 1);
+            const double singlePerSecond = single.calls * 1e9 / std::max<qint64>(single.nsecs, 1);
+            const double speedup = single.nsecs > 0 ? perSecond / singlePerSecond : 0;
+            qInfo().noquote() << QStringLiteral("%1 %2 %3 %4 %5")
+                                     .arg(threads, 8)
+                                     .arg(perSecond, 14, 'f', 0)
+                                     .arg(speedup, 10, 'f', 2)
+                                     .arg(QString::number(100 * speedup / threads, 'f', 0) + QLatin1Char('%'), 12)
+                                     .arg(result.firstCallNSecs / 1e6, 15, 'f', 2);
+        }
+    }
+    QFile::remove(KSycoca::absoluteFilePath());
+}
+
+void KSycocaThreadBenchmark::lookups_data()
+{
+    QTest::addColumn<int>("workloadIndex");
+    QTest::addColumn<int>("threads");
+
+    for (Workload workload : {ServiceByDesktopPath, QueryByMimeType, AllServices}) {
+        for (int threads : s_threadCounts) {
+            QTest::addRow("%s/%d", workloadName(workload), threads) << int(workload) << threads;
+        }
+    }
+}
+
+void KSycocaThreadBenchmark::lookups()
+{
+    QFETCH(int, workloadIndex);
+    QFETCH(int, threads);
+    const auto workload = Workload(workloadIndex);
+
+    const QStringList &entryPaths = m_entryPaths;
+    const QStringList mimeTypes{QStringLiteral("text/plain"), QStringLiteral("image/png"), QStringLiteral("application/x-bench7")};
+    const int calls = workload == ServiceByDesktopPath ? s_desktopPathLookups : workload == QueryByMimeType ? s_mimeTypeQueries : s_allServicesCalls;
+
+    std::atomic<qint64> firstCallNSecs;
+    std::atomic<int> failures;
+    // Runs in each thread, the first call creates the KSycoca instance of the thread
+    const auto work = [&](int threadIndex) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < calls; ++i) {
+            bool ok = true;
+            switch (workload) {
+            case ServiceByDesktopPath:
+                ok = bool(KService::serviceByDesktopPath(entryPaths.at((threadIndex * 7919 + i) % entryPaths.count())));
+                break;
+            case QueryByMimeType:
+                ok = !KApplicationTrader::queryByMimeType(mimeTypes.at(i % mimeTypes.count())).isEmpty();
+                break;
+            case AllServices:
+                ok = KService::allServices().count() == entryPaths.count();
+                break;
+            }
+            if (!ok) {
+                ++failures;
+            }
+            if (i == 0) {
+                firstCallNSecs += timer.nsecsElapsed();
+            }
+        }
+    };
+
+    Result &result = m_results[workload][threads];
+    QBENCHMARK {
+        firstCallNSecs = 0;
+        failures = 0;
+        std::vector<std::unique_ptr<QThread>> workers;
+        QElapsedTimer timer;
+        timer.start();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back(QThread::create(work, t));
+            workers.back()->start();
+        }
+        for (const auto &worker : workers) {
+            worker->wait();
+        }
+        const qint64 nsecs = timer.nsecsElapsed();
+        QCOMPARE(failures.load(), 0);
+
+        if (result.nsecs < 0 || nsecs < result.nsecs) {
+            result.nsecs = nsecs;
+            result.firstCallNSecs = firstCallNSecs / threads;
+            result.calls = qint64(calls) * threads;
+        }
+    }
+}
+
+#include "ksycocathreadbenchmark.moc"
@@ -6,7 +6,9 @@
     SPDX-License-Identifier: LGPL-2.0-only
 */
 
+#include "kbuildsycocadaemon.h"
 #include <kbuildsycoca_p.h>
+#include <kbuildsycocaprofiler_p.h>
 
 #include <kservice_version.h>
 
@@ -105,6 +107,16 @@ int main(int argc, char **argv)
         QCommandLineOption(QStringLiteral("track"), i18nc("@info:shell command-line option", "Track menu id for debug purposes"), QStringLiteral("menu-id")));
     parser.addOption(
         QCommandLineOption(QStringLiteral("testmode"), i18nc("@info:shell command-line option", "Switch QStandardPaths to test mode, for unit tests only")));
+    parser.addOption(QCommandLineOption(QStringLiteral("fastparser"),
+                                        i18nc("@info:shell command-line option", "Use the built-in desktop file parser instead of KConfig (faster)")));
+    parser.addOption(QCommandLineOption(QStringLiteral("delta"),
+                                        i18nc("@info:shell command-line option", "Write changes to applications as a delta instead of a new database")));
+    parser.addOption(QCommandLineOption(QStringLiteral("daemon"),
+                                        i18nc("@info:shell command-line option", "Keep running, and rebuild the database whenever the applications change")));
+    parser.addOption(QCommandLineOption(QStringLiteral("profile"), i18nc("@info:shell command-line option", "Print how long each phase of the build took")));
+    parser.addOption(QCommandLineOption(QStringLiteral("trace-file"),
+                                        i18nc("@info:shell command-line option", "Write the timings of the build to a file in the Chrome trace event format"),
+                                        QStringLiteral("json")));
     parser.process(app);
     about.processCommandLine(&parser);
 
@@ -120,14 +132,39 @@ int main(int argc, char **argv)
 
     const bool incremental = !parser.isSet(QStringLiteral("noincremental"));
 
+    const bool profile = parser.isSet(QStringLiteral("profile"));
+    const QString traceFile = parser.value(QStringLiteral("trace-file"));
+
+    if (parser.isSet(QStringLiteral("daemon")) && !bMenuTest) {
+        if (profile || !traceFile.isEmpty()) {
+            fprintf(stderr, "--profile and --trace-file are ignored in daemon mode\n");
+        }
+        KBuildSycocaDaemon daemon;
+        daemon.setDeltaUpdates(parser.isSet(QStringLiteral("delta")));
+        daemon.setUseDesktopEntryReader(parser.isSet(QStringLiteral("fastparser")));
+        if (!daemon.start(incremental)) {
+            return -1;
+        }
+        return app.exec();
+    }
+
     KBuildSycoca sycoca; // Build data base
     if (parser.isSet(QStringLiteral("track"))) {
         sycoca.setTrackId(parser.value(QStringLiteral("track")));
     }
     sycoca.setMenuTest(bMenuTest);
-    if (!sycoca.recreate(incremental)) {
-        return -1;
+    sycoca.setUseDesktopEntryReader(parser.isSet(QStringLiteral("fastparser")));
+    if (parser.isSet(QStringLiteral("delta"))) {
+        sycoca.setDeltaUpdates(true);
     }
+    KBuildSycocaProfiler::setEnabled(profile || !traceFile.isEmpty());
+    const bool ok = sycoca.recreate(incremental);
 
-    return 0;
+    if (profile) {
+        fprintf(stderr, "%s", qPrintable(KBuildSycocaProfiler::summary()));
+    }
+    if (!traceFile.isEmpty() && !KBuildSycocaProfiler::writeTrace(traceFile)) {
+        return -1;
+    }
+    return ok ? 0 : -1;
 }
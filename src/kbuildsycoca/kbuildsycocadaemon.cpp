@@ -0,0 +1,160 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kbuildsycocadaemon.h"
+#include "sycocadebug.h"
+
+#include <ksycoca_p.h>
+#include <ksycocamemfd_p.h>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+// Wait for this long without changes before rebuilding, so that e.g. a package installing
+// many desktop files triggers only one build
+static const int s_quietPeriodMs = 500;
+// But never delay a build longer than this while changes keep coming
+static const int s_maxDelayMs = 5000;
+
+static void lowerPriority()
+{
+#ifdef Q_OS_UNIX
+    if (setpriority(PRIO_PROCESS, 0, 19) != 0) {
+        qCWarning(SYCOCA) << "Couldn't lower the CPU priority:" << strerror(errno);
+    }
+#endif
+#if defined(Q_OS_LINUX) && defined(SYS_ioprio_set)
+    // glibc has no wrapper for ioprio_set(2)
+    const int ioprioWhoProcess = 1;
+    const int ioprioClassIdle = 3;
+    const int ioprioClassShift = 13;
+    if (syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift) != 0) {
+        qCWarning(SYCOCA) << "Couldn't lower the IO priority:" << strerror(errno);
+    }
+#endif
+}
+
+KBuildSycocaDaemon::KBuildSycocaDaemon(QObject *parent)
+    : QObject(parent)
+    , m_lockFile(KSycocaPrivate::daemonLockFilePath(KSycoca::absoluteFilePath()))
+{
+    m_lockFile.setStaleLockTime(0); // only stale if this process is gone
+    m_rebuildTimer.setSingleShot(true);
+    m_rebuildTimer.setInterval(s_quietPeriodMs);
+    connect(&m_rebuildTimer, &QTimer::timeout, this, [this]() {
+        rebuild(true);
+    });
+
+    connect(&m_dirWatch, &KDirWatch::dirty, this, &KBuildSycocaDaemon::scheduleRebuild);
+    connect(&m_dirWatch, &KDirWatch::created, this, &KBuildSycocaDaemon::scheduleRebuild);
+    connect(&m_dirWatch, &KDirWatch::deleted, this, &KBuildSycocaDaemon::scheduleRebuild);
+}
+
+KBuildSycocaDaemon::~KBuildSycocaDaemon()
+{
+#ifdef Q_OS_UNIX
+    if (m_memFd >= 0) {
+        // Readers would only find a dangling pid and fd in it
+        KSycocaMemFd::unpublish(KSycoca::absoluteFilePath(), m_memFd);
+        ::close(m_memFd);
+    }
+#endif
+}
+
+bool KBuildSycocaDaemon::start(bool incremental)
+{
+    // Applications leave the rebuilds to us while we hold it, see KSycocaPrivate::checkDirectories()
+    QDir().mkpath(QFileInfo(KSycoca::absoluteFilePath()).absolutePath());
+    if (!m_lockFile.tryLock(1000)) {
+        qCWarning(SYCOCA) << "Another kbuildsycoca daemon is running for" << KSycoca::absoluteFilePath();
+        return false;
+    }
+    lowerPriority();
+    rebuild(incremental);
+    return m_buildState != nullptr;
+}
+
+void KBuildSycocaDaemon::scheduleRebuild(const QString &path)
+{
+    qCDebug(SYCOCA) << "Changed:" << path;
+    if (!m_pendingSince.isValid()) {
+        m_pendingSince.start();
+    }
+    if (m_pendingSince.elapsed() + s_quietPeriodMs <= s_maxDelayMs) {
+        m_rebuildTimer.start(); // restart the quiet period
+    } else if (!m_rebuildTimer.isActive()) {
+        m_rebuildTimer.start(0);
+    }
+}
+
+void KBuildSycocaDaemon::rebuild(bool incremental)
+{
+    m_pendingSince.invalidate();
+
+    KBuildSycoca sycoca;
+    if (m_deltaUpdates) {
+        sycoca.setDeltaUpdates(true);
+    }
+    sycoca.setUseDesktopEntryReader(m_useDesktopEntryReader);
+    sycoca.setPreviousBuild(std::exchange(m_buildState, nullptr));
+    if (!sycoca.recreate(incremental)) {
+        qCWarning(SYCOCA) << "Building the database failed, waiting for the next change";
+    }
+    m_buildState = sycoca.buildState();
+    if (sycoca.usesMemFdStrategy()) {
+        publishMemFd();
+    }
+
+    // The menu may have pulled in more directories
+    watch(KBuildSycoca::factoryResourceDirs() + sycoca.resourceDirs(), KBuildSycoca::factoryExtraFiles());
+}
+
+void KBuildSycocaDaemon::watch(const QStringList &dirs, const QStringList &files)
+{
+    for (const QString &dir : dirs) {
+        if (!m_watchedDirs.contains(dir)) {
+            m_watchedDirs.insert(dir);
+            m_dirWatch.addDir(dir, KDirWatch::WatchSubDirs | KDirWatch::WatchFiles);
+        }
+    }
+    // mimeapps.list files, which KDirWatch also watches for creation
+    for (const QString &file : files) {
+        if (!m_watchedFiles.contains(file)) {
+            m_watchedFiles.insert(file);
+            m_dirWatch.addFile(file);
+        }
+    }
+}
+
+void KBuildSycocaDaemon::publishMemFd()
+{
+#ifdef Q_OS_UNIX
+    const int fd = KSycocaMemFd::publish(KSycoca::absoluteFilePath());
+    if (fd < 0) {
+        return;
+    }
+    // Readers which opened the previous one keep it mapped
+    if (m_memFd >= 0) {
+        ::close(m_memFd);
+    }
+    m_memFd = fd;
+#endif
+}
+
+#include "moc_kbuildsycocadaemon.cpp"
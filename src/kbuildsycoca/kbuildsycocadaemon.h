@@ -0,0 +1,70 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KBUILDSYCOCADAEMON_H
+#define KBUILDSYCOCADAEMON_H
+
+#include <kbuildsycoca_p.h>
+
+#include <KDirWatch>
+
+#include <QElapsedTimer>
+#include <QLockFile>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+#include <memory>
+
+/*
+ * kbuildsycoca --daemon: watches the directories and files the database is built from,
+ * and rebuilds it shortly after they change, so that applications don't have to.
+ * The entries parsed by a build are kept for the next one, which then doesn't need to read them back
+ * from the database.
+ */
+class KBuildSycocaDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit KBuildSycocaDaemon(QObject *parent = nullptr);
+    ~KBuildSycocaDaemon() override;
+
+    void setDeltaUpdates(bool b)
+    {
+        m_deltaUpdates = b;
+    }
+
+    void setUseDesktopEntryReader(bool b)
+    {
+        m_useDesktopEntryReader = b;
+    }
+
+    /*
+     * Takes the daemon lock file, lowers the CPU and IO priority of the process, then builds the database
+     * and starts watching for changes. Returns false if another daemon is running, or if the first build failed.
+     */
+    bool start(bool incremental);
+
+private:
+    void scheduleRebuild(const QString &path);
+    void rebuild(bool incremental);
+    void watch(const QStringList &dirs, const QStringList &files);
+    void publishMemFd();
+
+    QLockFile m_lockFile; // see KSycocaPrivate::isDaemonRunning()
+    KDirWatch m_dirWatch;
+    QTimer m_rebuildTimer;
+    QElapsedTimer m_pendingSince; // since the first change not built yet
+    QSet<QString> m_watchedDirs;
+    QSet<QString> m_watchedFiles;
+    std::shared_ptr<const KBuildSycoca::BuildState> m_buildState;
+    bool m_deltaUpdates = false;
+    bool m_useDesktopEntryReader = false;
+    int m_memFd = -1; // the published database, see KSycocaMemFd
+};
+
+#endif
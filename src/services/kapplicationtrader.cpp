@@ -14,35 +14,52 @@
 #include "ksycoca_p.h"
 #include "servicesdebug.h"
 
+#include <QHash>
 #include <QMimeDatabase>
 
 #include <KConfigGroup>
 #include <KSharedConfig>
 
-static KService::List mimeTypeSycocaServiceOffers(const QString &mimeType)
+#include <algorithm>
+#include <tuple>
+
+// The caller must call KSycoca::self()->ensureCacheValid() first, since that can invalidate the offsets
+static QList<qint32> mimeTypeSycocaServiceOfferOffsets(const QString &mimeType)
 {
-    KService::List lst;
     QMimeDatabase db;
     QString mime = db.mimeTypeForName(mimeType).name();
     if (mime.isEmpty()) {
         if (!mimeType.startsWith(QLatin1String("x-scheme-handler/"))) { // don't warn for unknown scheme handler mimetypes
             qCWarning(SERVICES) << "KApplicationTrader: mimeType" << mimeType << "not found";
-            return lst; // empty
+            return {};
         }
         mime = mimeType;
     }
-    KSycoca::self()->ensureCacheValid();
     KMimeTypeFactory *factory = KSycocaPrivate::self()->mimeTypeFactory();
     const int offset = factory->entryOffset(mime);
     if (!offset) {
         if (!mimeType.startsWith(QLatin1String("x-scheme-handler/"))) { // don't warn for unknown scheme handler mimetypes
             qCWarning(SERVICES) << "KApplicationTrader: mimeType" << mimeType << "not found";
         }
-        return lst; // empty
+        return {};
     }
+    // Also called without offers in the database (-1), the delta may have added some
     const int serviceOffersOffset = factory->serviceOffersOffset(mime);
-    if (serviceOffersOffset > -1) {
-        lst = KSycocaPrivate::self()->serviceFactory()->serviceOffers(offset, serviceOffersOffset);
+    return KSycocaPrivate::self()->serviceFactory()->serviceOfferOffsets(offset, serviceOffersOffset);
+}
+
+static KService::List mimeTypeSycocaServiceOffers(const QString &mimeType)
+{
+    KSycoca::self()->ensureCacheValid();
+    KServiceFactory *factory = KSycocaPrivate::self()->serviceFactory();
+
+    KService::List lst;
+    const QList<qint32> offsets = mimeTypeSycocaServiceOfferOffsets(mimeType);
+    lst.reserve(offsets.size());
+    for (const qint32 offset : offsets) {
+        if (KService::Ptr service = factory->serviceAtOffset(offset)) {
+            lst.append(service);
+        }
     }
     return lst;
 }
@@ -84,6 +101,74 @@ KService::List KApplicationTrader::queryByMimeType(const QString &mimeType, Filt
     return lst;
 }
 
+KService::List KApplicationTrader::queryByMimeTypes(const QStringList &mimeTypes, MatchMode mode, FilterFunc filterFunc)
+{
+    struct Rank {
+        qsizetype bestPosition;
+        qsizetype firstList; // index of the first list containing the service
+        qsizetype positionInFirstList;
+        qsizetype positionSum;
+        qsizetype listCount;
+        qsizetype lastList;
+    };
+
+    // Resolve all the offer lists first, so that services shared by several MIME types are decoded only once
+    KSycoca::self()->ensureCacheValid();
+    QStringList uniqueMimeTypes = mimeTypes;
+    uniqueMimeTypes.removeDuplicates();
+
+    QHash<qint32, Rank> ranks;
+    QList<qint32> offsets; // in order of first appearance
+    for (qsizetype list = 0; list < uniqueMimeTypes.size(); ++list) {
+        const QList<qint32> offerOffsets = mimeTypeSycocaServiceOfferOffsets(uniqueMimeTypes.at(list));
+        for (qsizetype pos = 0; pos < offerOffsets.size(); ++pos) {
+            const qint32 offset = offerOffsets.at(pos);
+            auto it = ranks.find(offset);
+            if (it == ranks.end()) {
+                ranks.insert(offset, Rank{pos, list, pos, pos, 1, list});
+                offsets.append(offset);
+            } else if (it->lastList != list) { // the same service can be listed twice for one MIME type (e.g. via an alias)
+                it->bestPosition = std::min(it->bestPosition, pos);
+                it->positionSum += pos;
+                ++it->listCount;
+                it->lastList = list;
+            }
+        }
+    }
+
+    if (mode == MatchMode::Intersection) {
+        const qsizetype listCount = uniqueMimeTypes.size();
+        offsets.removeIf([&](qint32 offset) {
+            return ranks.value(offset).listCount != listCount;
+        });
+        std::stable_sort(offsets.begin(), offsets.end(), [&](qint32 lhs, qint32 rhs) {
+            const Rank l = ranks.value(lhs);
+            const Rank r = ranks.value(rhs);
+            return std::tie(l.positionSum, l.positionInFirstList) < std::tie(r.positionSum, r.positionInFirstList);
+        });
+    } else {
+        std::stable_sort(offsets.begin(), offsets.end(), [&](qint32 lhs, qint32 rhs) {
+            const Rank l = ranks.value(lhs);
+            const Rank r = ranks.value(rhs);
+            return std::tie(l.bestPosition, l.firstList) < std::tie(r.bestPosition, r.firstList);
+        });
+    }
+
+    KServiceFactory *factory = KSycocaPrivate::self()->serviceFactory();
+    KService::List lst;
+    lst.reserve(offsets.size());
+    for (const qint32 offset : std::as_const(offsets)) {
+        if (KService::Ptr service = factory->serviceAtOffset(offset)) {
+            lst.append(service);
+        }
+    }
+
+    applyFilter(lst, filterFunc, false); // false = allow NotShowIn=KDE services listed in mimeapps.list
+
+    qCDebug(SERVICES) << "query for mimeTypes" << mimeTypes << "returning" << lst.count() << "offers";
+    return lst;
+}
+
 KService::Ptr KApplicationTrader::preferredService(const QString &mimeType)
 {
     const KService::List offers = queryByMimeType(mimeType);
@@ -67,6 +67,44 @@ KSERVICE_EXPORT KService::List query(FilterFunc filterFunc);
  */
 KSERVICE_EXPORT KService::List queryByMimeType(const QString &mimeType, FilterFunc filterFunc = {});
 
+/*!
+ * \enum KApplicationTrader::MatchMode
+ *
+ * How queryByMimeTypes() combines the services associated with each MIME type.
+ *
+ * \value Union Services associated with at least one of the MIME types
+ * \value Intersection Services associated with all of the MIME types
+ *
+ * \since 6.29
+ */
+enum class MatchMode {
+    Union,
+    Intersection,
+};
+
+/*!
+ * This method returns a list of services (applications) which are associated with several MIME types at once,
+ * e.g. for an "Open With" menu on a selection of files of different types.
+ *
+ * This is faster than calling queryByMimeType() for every MIME type and merging the results,
+ * since services associated with several of the MIME types are only looked up once.
+ *
+ * \a mimeTypes the MIME types, like 'text/plain' or 'text/html'
+ *
+ * \a mode whether to return services associated with any or with all of the MIME types
+ *
+ * \a filterFunc a callback function that returns \c true if the application
+ * should be selected and \c false if it should be skipped.
+ *
+ * Returns a list of services that satisfy the query, sorted by preference (preferred service first).
+ * With Union, services are ordered by their best position in any of the MIME types' lists,
+ * ties being resolved in the order of \a mimeTypes. With Intersection, services are ordered by the
+ * sum of their positions in all lists, ties being resolved by their position for the first MIME type.
+ *
+ * \since 6.29
+ */
+KSERVICE_EXPORT KService::List queryByMimeTypes(const QStringList &mimeTypes, MatchMode mode, FilterFunc filterFunc = {});
+
 /*!
  * Returns the preferred service for \a mimeType
  *
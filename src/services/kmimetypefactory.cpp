@@ -12,6 +12,7 @@
 #include <QDataStream>
 #include <ksycoca.h>
 #include <ksycocadict_p.h>
+#include <ksycocastatistics_p.h>
 
 extern int servicesDebugArea();
 
@@ -38,18 +39,18 @@ int KMimeTypeFactory::serviceOffersOffset(const QString &mimeTypeName)
 {
     const int offset = entryOffset(mimeTypeName.toLower());
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::MimeTypesByName, false);
         return -1; // Not found
     }
 
     MimeTypeEntry::Ptr newMimeType(createEntry(offset));
-    if (!newMimeType) {
-        return -1;
-    }
     // Check whether the dictionary was right.
-    if (newMimeType->name() != mimeTypeName.toLower()) {
+    if (!newMimeType || newMimeType->name() != mimeTypeName.toLower()) {
         // No it wasn't...
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::MimeTypesByName, false);
         return -1;
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::MimeTypesByName, true);
     return newMimeType->serviceOffersOffset();
 }
 
@@ -60,12 +61,25 @@ KMimeTypeFactory::MimeTypeEntry *KMimeTypeFactory::createEntry(int offset) const
     if (!str) {
         return nullptr;
     }
+    return readMimeTypeEntry(*str, offset, type);
+}
 
+KMimeTypeFactory::MimeTypeEntry *KMimeTypeFactory::decodeEntry(QDataStream &str, int offset) const
+{
+    qint32 type;
+    str >> type;
+    return readMimeTypeEntry(str, offset, KSycocaType(type));
+}
+
+KMimeTypeFactory::MimeTypeEntry *KMimeTypeFactory::readMimeTypeEntry(QDataStream &str, int offset, KSycocaType type) const
+{
     if (type != KST_KMimeTypeEntry) {
         qCWarning(SERVICES) << "KMimeTypeFactory: unexpected object entry in KSycoca database (type=" << int(type) << ")";
         return nullptr;
     }
-    MimeTypeEntry *newEntry = new MimeTypeEntry(*str, offset);
+    const qint64 start = str.device()->pos();
+    MimeTypeEntry *newEntry = new MimeTypeEntry(str, offset);
+    KSycocaStatistics::recordEntry(KSycoca::Statistics::MimeTypeEntry, str.device()->pos() - start);
     if (newEntry && !newEntry->isValid()) {
         qCWarning(SERVICES) << "KMimeTypeFactory: corrupt object in KSycoca database!\n";
         delete newEntry;
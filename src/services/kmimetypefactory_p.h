@@ -92,8 +92,11 @@ public: // public for KBuildServiceFactory
 
 protected:
     MimeTypeEntry *createEntry(int offset) const override;
+    MimeTypeEntry *decodeEntry(QDataStream &str, int offset) const override;
 
 private:
+    MimeTypeEntry *readMimeTypeEntry(QDataStream &str, int offset, KSycocaType type) const;
+
     // d pointer: useless since this header is not installed
     // class KMimeTypeFactoryPrivate* d;
 };
@@ -26,11 +26,13 @@
 #include <QDebug>
 #include <QStandardPaths>
 
+#include "kdesktopentryreader_p.h"
 #include "kservicefactory_p.h"
 #include "kserviceutil_p.h"
 #include "servicesdebug.h"
 
-void KServicePrivate::init(const KDesktopFile *config, KService *q)
+template<typename DesktopFile>
+void KServicePrivate::init(const DesktopFile *config, KService *q)
 {
     const QString entryPath = q->entryPath();
     if (entryPath.isEmpty()) {
@@ -41,7 +43,7 @@ void KServicePrivate::init(const KDesktopFile *config, KService *q)
 
     bool absPath = !QDir::isRelativePath(entryPath);
 
-    const KConfigGroup desktopGroup = config->desktopGroup();
+    const auto desktopGroup = config->desktopGroup();
     QMap<QString, QString> entryMap = desktopGroup.entryMap();
 
     entryMap.remove(QStringLiteral("Encoding")); // reserved as part of Desktop Entry Standard
@@ -160,7 +162,8 @@ void KServicePrivate::init(const KDesktopFile *config, KService *q)
     }
 }
 
-void KServicePrivate::parseActions(const KDesktopFile *config, KService *q)
+template<typename DesktopFile>
+void KServicePrivate::parseActions(const DesktopFile *config, KService *q)
 {
     const QStringList keys = config->readActions();
     if (keys.isEmpty()) {
@@ -178,7 +181,7 @@ void KServicePrivate::parseActions(const KDesktopFile *config, KService *q)
             continue;
         }
 
-        const KConfigGroup cg = config->actionGroup(group);
+        const auto cg = config->actionGroup(group);
         if (!cg.hasKey("Name")) {
             qCWarning(SERVICES) << "The action" << group << "in the desktop file" << q->entryPath() << "has no Name key";
             continue;
@@ -228,7 +231,8 @@ void KServicePrivate::load(QDataStream &s)
       >> m_lstKeywords >> m_strGenName
       >> categories >> menuId >> m_actions
       >> unused3
-      >> m_untranslatedName >> m_untranslatedGenericName >> m_mimeTypes;
+      >> m_untranslatedName >> m_untranslatedGenericName >> m_mimeTypes
+      >> m_actionsData;
     // clang-format on
 
     m_bTerminal = bool(term);
@@ -238,6 +242,12 @@ void KServicePrivate::load(QDataStream &s)
 
 void KServicePrivate::save(QDataStream &s)
 {
+    if (!m_savedRecord.isEmpty()) {
+        // Unchanged since the previous database: the record doesn't contain any offset, copy it
+        offset = s.device()->pos();
+        s.writeRawData(m_savedRecord.constData(), m_savedRecord.size());
+        return;
+    }
     KSycocaEntryPrivate::save(s);
     qint8 term = m_bTerminal;
     qint8 dst = 0;
@@ -246,9 +256,32 @@ void KServicePrivate::save(QDataStream &s)
     // !! This data structure should remain binary compatible at all times !!
     // You may add new fields at the end. Make sure to update KSYCOCA_VERSION
     // number in ksycoca.cpp
+    // The actions are stored serialized at the end of the record, so that load() only has to copy
+    // the bytes and actions() decodes them when needed. Actions which were loaded from the previous
+    // database and never used are written back as they are.
+    QByteArray actionsData = m_actionsData;
+    if (actionsData.isEmpty() && !m_actions.isEmpty()) {
+        QDataStream actionsStream(&actionsData, QIODevice::WriteOnly);
+        actionsStream.setVersion(QDataStream::Qt_5_3);
+        actionsStream << m_actions;
+    }
     s << m_strType << m_strName << m_strExec << m_strIcon << term << m_strTerminalOptions << m_strWorkingDirectory << m_strComment
       << qint8(false) /* unused */ << m_mapProps << QString() /* unused */ << dst << m_strDesktopEntryName << m_lstKeywords << m_strGenName << categories
-      << menuId << m_actions << QStringList() /* unused */ << m_untranslatedName << m_untranslatedGenericName << m_mimeTypes;
+      << menuId << QList<KServiceAction>() /* see actionsData */ << QStringList() /* unused */ << m_untranslatedName << m_untranslatedGenericName
+      << m_mimeTypes << actionsData;
+}
+
+QList<KServiceAction> KServicePrivate::actions() const
+{
+    QMutexLocker locker(&m_actionsCache.mutex);
+    if (!m_actionsData.isEmpty()) {
+        // Same version as the database stream, see KServicePrivate::save
+        QDataStream actionsStream(m_actionsData);
+        actionsStream.setVersion(QDataStream::Qt_5_3);
+        actionsStream >> m_actions;
+        m_actionsData.clear();
+    }
+    return m_actions;
 }
 
 ////
@@ -273,6 +306,14 @@ KService::KService(const QString &_fullpath)
     d->init(&config, this);
 }
 
+KService::KService(const KDesktopEntryReader &reader)
+    : KSycocaEntry(*new KServicePrivate(reader.fileName()))
+{
+    Q_D(KService);
+
+    d->init(&reader, this);
+}
+
 KService::KService(const KDesktopFile *config, const QString &entryPath)
     : KSycocaEntry(*new KServicePrivate(entryPath.isEmpty() ? config->fileName() : entryPath))
 {
@@ -308,10 +349,11 @@ bool KService::hasMimeType(const QString &mimeType) const
         KSycoca::self()->ensureCacheValid();
         KMimeTypeFactory *factory = KSycocaPrivate::self()->mimeTypeFactory();
         const int mimeOffset = factory->entryOffset(mime);
-        const int serviceOffersOffset = factory->serviceOffersOffset(mime);
-        if (serviceOffersOffset == -1) {
+        if (!mimeOffset) {
             return false;
         }
+        // -1 if the database has no offers for it, the delta may have added some
+        const int serviceOffersOffset = factory->serviceOffersOffset(mime);
         return KSycocaPrivate::self()->serviceFactory()->hasOffer(mimeOffset, serviceOffersOffset, serviceOffset);
     }
 
@@ -578,7 +620,12 @@ QString KService::menuId() const
 void KService::setMenuId(const QString &_menuId)
 {
     Q_D(KService);
+    if (d->menuId == _menuId) {
+        return; // kbuildsycoca sets the same menu id again on every incremental build
+    }
     d->menuId = _menuId;
+    d->m_savedRecord.clear();
+    d->invalidateActionsCache();
 }
 
 QString KService::storageId() const
@@ -754,12 +801,16 @@ void KService::setTerminal(bool b)
 {
     Q_D(KService);
     d->m_bTerminal = b;
+    d->m_savedRecord.clear();
+    d->invalidateActionsCache();
 }
 
 void KService::setTerminalOptions(const QString &options)
 {
     Q_D(KService);
     d->m_strTerminalOptions = options;
+    d->m_savedRecord.clear();
+    d->invalidateActionsCache();
 }
 
 void KService::setExec(const QString &exec)
@@ -769,6 +820,8 @@ void KService::setExec(const QString &exec)
     if (!exec.isEmpty()) {
         d->m_strExec = exec;
         d->path.clear();
+        d->m_savedRecord.clear();
+        d->invalidateActionsCache();
     }
 }
 
@@ -779,26 +832,45 @@ void KService::setWorkingDirectory(const QString &workingDir)
     if (!workingDir.isEmpty()) {
         d->m_strWorkingDirectory = workingDir;
         d->path.clear();
+        d->m_savedRecord.clear();
+        d->invalidateActionsCache();
     }
 }
 
 QList<KServiceAction> KService::actions() const
+{
+    return actions(ActionsOption::WithService);
+}
+
+QList<KServiceAction> KService::actions(ActionsOption option) const
 {
     Q_D(const KService);
 
+    if (option == ActionsOption::WithoutService) {
+        return d->actions();
+    }
+
     // Both KService and KServiceAction have strong references to each other in the public API.
     // The main purpose of the serviceClone is to break the cycle to prevent a memory leak.
+    // It is created only once: the clone doesn't reference this service, so caching it is cycle-free too.
+    // The clone is shared by all callers, which is documented as making it read-only.
     //
     // TODO KF7: Remove KServiceAction::service() or downgrade it to a weak pointer, the current
     // API is prone to memory leaks.
-    KService::Ptr serviceClone(new KService(*this));
+    QList<KServiceAction> actions = d->actions();
 
-    QList<KServiceAction> actions = d->m_actions;
-    for (KServiceAction &action : actions) {
-        action.setService(serviceClone);
+    QMutexLocker locker(&d->m_actionsCache.mutex);
+    if (!d->m_actionsCache.valid) {
+        KService::Ptr serviceClone(new KService(*this));
+
+        for (KServiceAction &action : actions) {
+            action.setService(serviceClone);
+        }
+        d->m_actionsCache.actions = actions;
+        d->m_actionsCache.valid = true;
     }
 
-    return actions;
+    return d->m_actionsCache.actions;
 }
 
 QString KService::aliasFor() const
@@ -809,7 +881,11 @@ QString KService::aliasFor() const
 void KService::setActions(const QList<KServiceAction> &actions)
 {
     Q_D(KService);
+    d->invalidateActionsCache();
+    QMutexLocker locker(&d->m_actionsCache.mutex);
     d->m_actions = actions;
+    d->m_actionsData.clear();
+    d->m_savedRecord.clear();
 }
 
 std::optional<bool> KService::startupNotify() const
@@ -20,6 +20,7 @@
 #include <optional>
 
 class QDataStream;
+class KDesktopEntryReader;
 class KDesktopFile;
 class QWidget;
 
@@ -258,10 +259,40 @@ public:
      *
      * Only valid actions according to specification are included.
      *
+     * The service() of every action is a copy of this service, which is created
+     * on the first call and shared by subsequent calls until this service is modified.
+     * Since all callers get the same copy, it must be treated as immutable: to change it
+     * (e.g. with KService::setExec()), make a copy of it first, as in
+     * \c{KService::Ptr service(new KService(*action.service()))}.
+     *
      * \note This function copies the action list.
      */
     QList<KServiceAction> actions() const;
 
+    /*!
+     * \enum KService::ActionsOption
+     *
+     * \value WithService Every action references a copy of this service, as with actions()
+     * \value WithoutService The actions don't reference any service, KServiceAction::service() returns a null pointer.
+     *        This is the cheapest way to list the actions when only their names, texts, icons and command lines are needed
+     *
+     * \since 6.29
+     */
+    enum class ActionsOption {
+        WithService,
+        WithoutService,
+    };
+
+    /*!
+     * Returns the actions defined in this desktop file.
+     *
+     * \a option whether the actions should reference this service
+     *
+     * \sa actions()
+     * \since 6.29
+     */
+    QList<KServiceAction> actions(ActionsOption option) const;
+
     /*!
      * Returns whether this application can handle several files as
      * startup arguments.
@@ -503,6 +534,12 @@ private:
      * The stream must already be positioned at the correct offset.
      */
     KSERVICE_NO_EXPORT KService(QDataStream &str, int offset);
+
+    /*!
+     * \internal
+     * Construct a service from a desktop file parsed by kbuildsycoca's reader.
+     */
+    KSERVICE_NO_EXPORT explicit KService(const KDesktopEntryReader &reader);
 };
 
 template<>
@@ -11,6 +11,7 @@
 
 #include "kservice.h"
 #include <QList>
+#include <QMutex>
 
 #include <ksycocaentry_p.h>
 
@@ -32,9 +33,12 @@ public:
     }
     KServicePrivate(const KServicePrivate &other) = default;
 
-    void init(const KDesktopFile *config, KService *q);
+    // DesktopFile is either KDesktopFile or KDesktopEntryReader (faster, used by kbuildsycoca)
+    template<typename DesktopFile>
+    void init(const DesktopFile *config, KService *q);
 
-    void parseActions(const KDesktopFile *config, KService *q);
+    template<typename DesktopFile>
+    void parseActions(const DesktopFile *config, KService *q);
     void load(QDataStream &);
     void save(QDataStream &) override;
 
@@ -58,6 +62,17 @@ public:
 
     QVariant property(const QString &_name, QMetaType::Type t) const;
 
+    // The actions, decoded from m_actionsData on first use
+    QList<KServiceAction> actions() const;
+
+    // Must be called by everything modifying the service, see KService::actions()
+    void invalidateActionsCache()
+    {
+        QMutexLocker locker(&m_actionsCache.mutex);
+        m_actionsCache.valid = false;
+        m_actionsCache.actions.clear();
+    }
+
     QStringList categories;
     QString menuId;
     QString m_strType;
@@ -74,7 +89,36 @@ public:
     QString m_strGenName;
     QString m_untranslatedGenericName;
     QString m_untranslatedName;
-    QList<KServiceAction> m_actions;
+    // Use actions() to read these: when loaded from the database, the actions stay
+    // serialized in m_actionsData until somebody asks for them.
+    mutable QList<KServiceAction> m_actions;
+    mutable QByteArray m_actionsData;
+
+    // The actions pointing to a clone of the service, created once by KService::actions().
+    // The service references the clone but not the other way around, so there is no cycle.
+    // The cache is not copied along with the service, a copy gets its own clone when needed.
+    // The mutex also guards the lazy decoding of m_actionsData.
+    struct ActionsCache {
+        ActionsCache() = default;
+        ActionsCache(const ActionsCache &)
+        {
+        }
+        ActionsCache &operator=(const ActionsCache &)
+        {
+            valid = false;
+            actions.clear();
+            return *this;
+        }
+        QMutex mutex;
+        QList<KServiceAction> actions;
+        bool valid = false;
+    };
+    mutable ActionsCache m_actionsCache;
+
+    // The record of this service in the previous database, when loaded by kbuildsycoca for an incremental build.
+    // save() writes it back as is, unless the service was modified meanwhile.
+    QByteArray m_savedRecord;
+
     bool m_bTerminal : 1;
     bool m_bValid : 1;
 };
@@ -104,6 +104,10 @@ public:
 
     /*!
      * Returns the service that this action comes from
+     *
+     * For actions returned by KService::actions(), this is a copy of the service
+     * which is shared by all the callers, and must not be modified, see KService::actions().
+     *
      * \since 5.69
      */
     KServicePtr service() const;
@@ -6,15 +6,19 @@
 */
 
 #include "kservice.h"
+#include "kservice_p.h"
 #include "kservicefactory_p.h"
 #include "ksycoca.h"
 #include "ksycocadict_p.h"
+#include "ksycocastatistics_p.h"
 #include "ksycocatype.h"
 #include "servicesdebug.h"
 #include <QDir>
 #include <QFile>
 #include <QScopedValueRollback>
 
+#include <algorithm>
+
 extern int servicesDebugArea();
 
 KServiceFactory::KServiceFactory(KSycoca *db)
@@ -84,8 +88,12 @@ KService::Ptr KServiceFactory::findServiceByName(const QString &_name)
     // But since findServiceByName isn't called in that case...
     // [ see KServiceTypeFactory for how to do it if needed ]
 
-    int offset = sycocaDict()->find_string(_name);
+    int offset = 0;
+    if (!deltaLookup(KSycocaDelta::StorageIdDict, _name, &offset)) {
+        offset = sycocaDict()->find_string(_name);
+    }
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByName, false);
         return KService::Ptr(); // Not found
     }
 
@@ -94,8 +102,10 @@ KService::Ptr KServiceFactory::findServiceByName(const QString &_name)
     // Check whether the dictionary was right.
     if (newService && (newService->name() != _name)) {
         // No it wasn't...
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByName, false);
         return KService::Ptr();
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByName, bool(newService));
     return newService;
 }
 
@@ -108,8 +118,12 @@ KService::Ptr KServiceFactory::findServiceByDesktopName(const QString &_name)
     // Warning : this assumes we're NOT building a database
     // KBuildServiceFactory reimplements it for the case where we are building one
 
-    int offset = m_nameDict->find_string(_name);
+    int offset = 0;
+    if (!deltaLookup(KSycocaDelta::DesktopNameDict, _name, &offset)) {
+        offset = m_nameDict->find_string(_name);
+    }
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopName, false);
         return KService::Ptr(); // Not found
     }
 
@@ -118,8 +132,10 @@ KService::Ptr KServiceFactory::findServiceByDesktopName(const QString &_name)
     // Check whether the dictionary was right.
     if (newService && (newService->desktopEntryName() != _name)) {
         // No it wasn't...
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopName, false);
         return KService::Ptr();
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopName, bool(newService));
     return newService;
 }
 
@@ -132,9 +148,13 @@ KService::Ptr KServiceFactory::findServiceByDesktopPath(const QString &_name)
     // Warning : this assumes we're NOT building a database
     // KBuildServiceFactory reimplements it for the case where we are building one
 
-    int offset = m_relNameDict->find_string(_name);
+    int offset = 0;
+    if (!deltaLookup(KSycocaDelta::DesktopPathDict, _name, &offset)) {
+        offset = m_relNameDict->find_string(_name);
+    }
     if (!offset) {
         // qCDebug(SERVICES) << "findServiceByDesktopPath:" << _name << "not found";
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopPath, false);
         return KService::Ptr(); // Not found
     }
 
@@ -147,8 +167,10 @@ KService::Ptr KServiceFactory::findServiceByDesktopPath(const QString &_name)
     // and the hash value gave us another one.
     if (newService && (newService->entryPath() != _name)) {
         // No it wasn't...
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopPath, false);
         return KService::Ptr();
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByDesktopPath, bool(newService));
     return newService;
 }
 
@@ -161,8 +183,12 @@ KService::Ptr KServiceFactory::findServiceByMenuId(const QString &_menuId)
     // Warning : this assumes we're NOT building a database
     // KBuildServiceFactory reimplements it for the case where we are building one
 
-    int offset = m_menuIdDict->find_string(_menuId);
+    int offset = 0;
+    if (!deltaLookup(KSycocaDelta::MenuIdDict, _menuId, &offset)) {
+        offset = m_menuIdDict->find_string(_menuId);
+    }
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByMenuId, false);
         return KService::Ptr(); // Not found
     }
 
@@ -171,8 +197,10 @@ KService::Ptr KServiceFactory::findServiceByMenuId(const QString &_menuId)
     // Check whether the dictionary was right.
     if (newService && (newService->menuId() != _menuId)) {
         // No it wasn't...
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByMenuId, false);
         return KService::Ptr();
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServicesByMenuId, bool(newService));
     return newService;
 }
 
@@ -210,13 +238,52 @@ KService::Ptr KServiceFactory::findServiceByStorageId(const QString &_storageId)
 
 KService *KServiceFactory::createEntry(int offset) const
 {
+    // Before looking into the database, which doesn't contain the services added by the delta
+    if (const QByteArray *record = deltaRecord(offset)) {
+        return readDeltaRecord(*record, offset);
+    }
     KSycocaType type;
     QDataStream *str = sycoca()->findEntry(offset, type);
+    return readService(*str, offset, type);
+}
+
+KService *KServiceFactory::decodeEntry(QDataStream &str, int offset) const
+{
+    qint32 type;
+    str >> type;
+    return readService(str, offset, KSycocaType(type));
+}
+
+KService *KServiceFactory::readService(QDataStream &str, int offset, KSycocaType type) const
+{
+    // Changed since the database was built, see KSycocaDelta
+    if (const QByteArray *record = deltaRecord(offset)) {
+        return readDeltaRecord(*record, offset);
+    }
+    return readServiceRecord(str, offset, type);
+}
+
+KService *KServiceFactory::readDeltaRecord(const QByteArray &record, int offset) const
+{
+    if (record.isEmpty()) {
+        return nullptr; // removed
+    }
+    QDataStream recordStream(record);
+    recordStream.setVersion(QDataStream::Qt_5_3);
+    qint32 recordType;
+    recordStream >> recordType;
+    return readServiceRecord(recordStream, offset, KSycocaType(recordType));
+}
+
+KService *KServiceFactory::readServiceRecord(QDataStream &str, int offset, KSycocaType type) const
+{
     if (type != KST_KService) {
         qCWarning(SERVICES) << "KServiceFactory: unexpected object entry in KSycoca database (type=" << int(type) << ")";
         return nullptr;
     }
-    KService *newEntry = new KService(*str, offset);
+    const qint64 start = str.device()->pos();
+    KService *newEntry = new KService(str, offset);
+    KSycocaStatistics::recordEntry(KSycoca::Statistics::ServiceEntry, str.device()->pos() - start);
     if (!newEntry->isValid()) {
         qCWarning(SERVICES) << "KServiceFactory: corrupt object in KSycoca database!";
         delete newEntry;
@@ -227,12 +294,39 @@ KService *KServiceFactory::createEntry(int offset) const
 
 KService::List KServiceFactory::allServices()
 {
+    // Decode straight into the result instead of going through allEntries(),
+    // which would build (and refcount) a second list of the same entries.
+    QList<KSycocaEntry *> decoded = decodeEntries(entryOffsets());
+    if (const KSycocaDelta *changes = delta()) {
+        const QList<qint32> addedOffsets = changes->addedOffsets();
+        for (const qint32 offset : addedOffsets) {
+            if (KService *service = createEntry(offset)) {
+                decoded.append(service);
+            }
+        }
+    }
+
     KService::List result;
-    const KSycocaEntry::List list = allEntries();
-    for (const auto &entryPtr : list) {
-        if (entryPtr->isType(KST_KService)) {
-            result.append(KService::Ptr(static_cast<KService *>(entryPtr.data())));
+    result.reserve(decoded.size());
+    for (KSycocaEntry *entry : std::as_const(decoded)) {
+        result.append(KService::Ptr(static_cast<KService *>(entry)));
+    }
+    return result;
+}
+
+KSycocaEntry::List KServiceFactory::allEntriesForReuse() const
+{
+    const QList<qint32> offsets = entryOffsets();
+    const QList<KSycocaEntry *> decoded = decodeEntries(offsets);
+    const QHash<qint32, QByteArray> records = entryRecords(offsets);
+
+    KSycocaEntry::List result;
+    result.reserve(decoded.size());
+    for (KSycocaEntry *entry : decoded) {
+        if (entry->isType(KST_KService)) {
+            static_cast<KService *>(entry)->d_func()->m_savedRecord = records.value(entry->offset());
         }
+        result.append(KSycocaEntry::Ptr(entry));
     }
     return result;
 }
@@ -245,37 +339,11 @@ QStringList KServiceFactory::resourceDirs()
 QList<KServiceOffer> KServiceFactory::offers(int serviceTypeOffset, int serviceOffersOffset)
 {
     QList<KServiceOffer> list;
-
-    // Jump to the offer list
-    QDataStream *str = stream();
-    str->device()->seek(m_offerListOffset + serviceOffersOffset);
-
-    qint32 aServiceTypeOffset;
-    qint32 aServiceOffset;
-    qint32 offerPreference;
-    qint32 mimeTypeInheritanceLevel;
-    while (true) {
-        (*str) >> aServiceTypeOffset;
-        if (aServiceTypeOffset) {
-            (*str) >> aServiceOffset;
-            (*str) >> offerPreference;
-            (*str) >> mimeTypeInheritanceLevel;
-            if (aServiceTypeOffset == serviceTypeOffset) {
-                // Save stream position !
-                const qint64 savedPos = str->device()->pos();
-                // Create Service
-                KService *serv = createEntry(aServiceOffset);
-                if (serv) {
-                    KService::Ptr servPtr(serv);
-                    list.append(KServiceOffer(servPtr, 1, mimeTypeInheritanceLevel));
-                }
-                // Restore position
-                str->device()->seek(savedPos);
-            } else {
-                break; // too far
-            }
-        } else {
-            break; // 0 => end of list
+    const QList<KSycocaDelta::Offer> records = offerRecords(serviceTypeOffset, serviceOffersOffset);
+    for (const KSycocaDelta::Offer &record : records) {
+        KService *serv = createEntry(record.first);
+        if (serv) {
+            list.append(KServiceOffer(KService::Ptr(serv), 1, record.second));
         }
     }
     return list;
@@ -284,64 +352,61 @@ QList<KServiceOffer> KServiceFactory::offers(int serviceTypeOffset, int serviceO
 KService::List KServiceFactory::serviceOffers(int serviceTypeOffset, int serviceOffersOffset)
 {
     KService::List list;
-
-    // Jump to the offer list
-    QDataStream *str = stream();
-    str->device()->seek(m_offerListOffset + serviceOffersOffset);
-
-    qint32 aServiceTypeOffset;
-    qint32 aServiceOffset;
-    qint32 offerPreference;
-    qint32 mimeTypeInheritanceLevel;
-    while (true) {
-        (*str) >> aServiceTypeOffset;
-        if (aServiceTypeOffset) {
-            (*str) >> aServiceOffset;
-            (*str) >> offerPreference; // unused (remove once KMimeTypeTrader/KServiceTypeTrader are gone)
-            (*str) >> mimeTypeInheritanceLevel; // unused (remove once KMimeTypeTrader/KServiceTypeTrader are gone)
-            if (aServiceTypeOffset == serviceTypeOffset) {
-                // Save stream position !
-                const qint64 savedPos = str->device()->pos();
-                // Create service
-                KService *serv = createEntry(aServiceOffset);
-                if (serv) {
-                    list.append(KService::Ptr(serv));
-                }
-                // Restore position
-                str->device()->seek(savedPos);
-            } else {
-                break; // too far
-            }
-        } else {
-            break; // 0 => end of list
+    const QList<qint32> offsets = serviceOfferOffsets(serviceTypeOffset, serviceOffersOffset);
+    list.reserve(offsets.size());
+    for (const qint32 offset : offsets) {
+        KService *serv = createEntry(offset);
+        if (serv) {
+            list.append(KService::Ptr(serv));
         }
     }
     return list;
 }
 
-bool KServiceFactory::hasOffer(int serviceTypeOffset, int serviceOffersOffset, int testedServiceOffset)
+QList<qint32> KServiceFactory::serviceOfferOffsets(int serviceTypeOffset, int serviceOffersOffset)
+{
+    QList<qint32> list;
+    const QList<KSycocaDelta::Offer> records = offerRecords(serviceTypeOffset, serviceOffersOffset);
+    list.reserve(records.size());
+    for (const KSycocaDelta::Offer &record : records) {
+        list.append(record.first);
+    }
+    return list;
+}
+
+QList<KSycocaDelta::Offer> KServiceFactory::offerRecords(int serviceTypeOffset, int serviceOffersOffset)
 {
+    // Changed since the database was built, see KSycocaDelta
+    if (const KSycocaDelta *changes = delta()) {
+        if (const QList<KSycocaDelta::Offer> *offers = changes->offers(serviceTypeOffset)) {
+            return *offers;
+        }
+    }
+
+    QList<KSycocaDelta::Offer> list;
+    if (serviceOffersOffset < 0) {
+        return list; // no offers in the database
+    }
+
     // Save stream position
     QDataStream *str = stream();
     const qint64 savedPos = str->device()->pos();
 
     // Jump to the offer list
     str->device()->seek(m_offerListOffset + serviceOffersOffset);
-    bool found = false;
+
     qint32 aServiceTypeOffset;
     qint32 aServiceOffset;
     qint32 offerPreference;
     qint32 mimeTypeInheritanceLevel;
-    while (!found) {
+    while (true) {
         (*str) >> aServiceTypeOffset;
         if (aServiceTypeOffset) {
             (*str) >> aServiceOffset;
-            (*str) >> offerPreference;
+            (*str) >> offerPreference; // unused (remove once KMimeTypeTrader/KServiceTypeTrader are gone)
             (*str) >> mimeTypeInheritanceLevel;
             if (aServiceTypeOffset == serviceTypeOffset) {
-                if (aServiceOffset == testedServiceOffset) {
-                    found = true;
-                }
+                list.append({aServiceOffset, mimeTypeInheritanceLevel});
             } else {
                 break; // too far
             }
@@ -351,7 +416,20 @@ bool KServiceFactory::hasOffer(int serviceTypeOffset, int serviceOffersOffset, i
     }
     // Restore position
     str->device()->seek(savedPos);
-    return found;
+    return list;
+}
+
+KService::Ptr KServiceFactory::serviceAtOffset(int offset)
+{
+    return KService::Ptr(createEntry(offset));
+}
+
+bool KServiceFactory::hasOffer(int serviceTypeOffset, int serviceOffersOffset, int testedServiceOffset)
+{
+    const QList<KSycocaDelta::Offer> records = offerRecords(serviceTypeOffset, serviceOffersOffset);
+    return std::any_of(records.cbegin(), records.cend(), [testedServiceOffset](const KSycocaDelta::Offer &record) {
+        return record.first == testedServiceOffset;
+    });
 }
 
 void KServiceFactory::virtual_hook(int id, void *data)
@@ -80,6 +80,23 @@ public:
      */
     KService::List serviceOffers(int serviceTypeOffset, int serviceOffersOffset);
 
+    /*!
+     * Returns the offsets of the services supporting the given service type, in order of preference,
+     * without decoding the services. Use serviceAtOffset() to decode them.
+     */
+    QList<qint32> serviceOfferOffsets(int serviceTypeOffset, int serviceOffersOffset);
+
+    /*!
+     * Returns the offer list of the given service type, as service offsets and MIME type inheritance levels,
+     * taking the delta of the database into account. \a serviceOffersOffset is -1 if the database has no offers for it.
+     */
+    QList<KSycocaDelta::Offer> offerRecords(int serviceTypeOffset, int serviceOffersOffset);
+
+    /*!
+     * Returns the service stored at \a offset, as returned by serviceOfferOffsets()
+     */
+    KService::Ptr serviceAtOffset(int offset);
+
     /*!
      * Test if a specific service is associated with a specific servicetype
      * @param serviceTypeOffset the offset of the service type being tested
@@ -93,6 +110,13 @@ public:
      */
     KService::List allServices();
 
+    /*!
+     * Returns all entries, like allEntries(), but every service also keeps a copy of its record,
+     * so that saving it into a new database is a plain copy as long as it isn't modified.
+     * Used by kbuildsycoca for incremental builds.
+     */
+    KSycocaEntry::List allEntriesForReuse() const;
+
     /*!
      * Returns the directories to watch for this factory.
      */
@@ -105,6 +129,7 @@ public:
 
 protected:
     KService *createEntry(int offset) const override;
+    KService *decodeEntry(QDataStream &str, int offset) const override;
 
     // All those variables are used by KBuildServiceFactory too
     int m_offerListOffset;
@@ -119,6 +144,10 @@ protected:
     void virtual_hook(int id, void *data) override;
 
 private:
+    KService *readService(QDataStream &str, int offset, KSycocaType type) const;
+    KService *readServiceRecord(QDataStream &str, int offset, KSycocaType type) const;
+    KService *readDeltaRecord(const QByteArray &record, int offset) const;
+
     class KServiceFactoryPrivate *d;
 };
 
@@ -9,6 +9,7 @@
 #include "kservicegroupfactory_p.h"
 #include "ksycoca.h"
 #include "ksycocadict_p.h"
+#include "ksycocastatistics_p.h"
 #include "ksycocatype.h"
 
 #include "servicesdebug.h"
@@ -49,6 +50,7 @@ KServiceGroup::Ptr KServiceGroupFactory::findGroupByDesktopPath(const QString &_
     }
     int offset = sycocaDict()->find_string(_name);
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServiceGroupsByPath, false);
         return KServiceGroup::Ptr(); // Not found
     }
 
@@ -59,6 +61,7 @@ KServiceGroup::Ptr KServiceGroupFactory::findGroupByDesktopPath(const QString &_
         // No it wasn't...
         newGroup = nullptr; // Not found
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServiceGroupsByPath, bool(newGroup));
     return newGroup;
 }
 
@@ -74,6 +77,7 @@ KServiceGroup::Ptr KServiceGroupFactory::findBaseGroup(const QString &_baseGroup
 
     int offset = m_baseGroupDict->find_string(_baseGroupName);
     if (!offset) {
+        KSycocaStatistics::recordLookup(KSycoca::Statistics::ServiceGroupsByBaseName, false);
         return KServiceGroup::Ptr(); // Not found
     }
 
@@ -84,19 +88,39 @@ KServiceGroup::Ptr KServiceGroupFactory::findBaseGroup(const QString &_baseGroup
         // No it wasn't...
         newGroup = nullptr; // Not found
     }
+    KSycocaStatistics::recordLookup(KSycoca::Statistics::ServiceGroupsByBaseName, bool(newGroup));
     return newGroup;
 }
 
 KServiceGroup *KServiceGroupFactory::createGroup(int offset, bool deep) const
 {
+    // Changed since the database was built, see KSycocaDelta
+    const QByteArray *record = deltaRecord(offset);
+    if (record && record->isEmpty()) {
+        return nullptr; // removed
+    }
+    QDataStream recordStream(record ? *record : QByteArray());
+    recordStream.setVersion(QDataStream::Qt_5_3);
+
     KSycocaType type;
-    QDataStream *str = sycoca()->findEntry(offset, type);
+    QDataStream *str;
+    if (record) {
+        qint32 recordType;
+        recordStream >> recordType;
+        type = KSycocaType(recordType);
+        str = &recordStream;
+    } else {
+        str = sycoca()->findEntry(offset, type);
+    }
     if (type != KST_KServiceGroup) {
         qCWarning(SERVICES) << "KServiceGroupFactory: unexpected object entry in KSycoca database (type = " << int(type) << ")";
         return nullptr;
     }
 
+    // Deep groups also decode their children, which count for themselves
+    const qint64 start = str->device()->pos();
     KServiceGroup *newEntry = new KServiceGroup(*str, offset, deep);
+    KSycocaStatistics::recordEntry(KSycoca::Statistics::ServiceGroupEntry, deep ? 0 : str->device()->pos() - start);
     if (!newEntry->isValid()) {
         qCWarning(SERVICES) << "KServiceGroupFactory: corrupt object in KSycoca database!";
         delete newEntry;
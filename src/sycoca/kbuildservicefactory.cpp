@@ -9,6 +9,8 @@
 #include "kbuildmimetypefactory_p.h"
 #include "kbuildservicefactory_p.h"
 #include "kbuildservicegroupfactory_p.h"
+#include "kbuildsycocaprofiler_p.h"
+#include "kdesktopentryreader_p.h"
 #include "ksycoca.h"
 
 #include "ksycocadict_p.h"
@@ -64,7 +66,18 @@ KSycocaEntry *KBuildServiceFactory::createEntry(const QString &file) const
         qCDebug(SYCOCA) << file;
 
         Q_ASSERT(QDir::isAbsolutePath(file));
-        KService *serv = new KService(file);
+        KService *serv = nullptr;
+        if (m_useDesktopEntryReader) {
+            const KDesktopEntryReader reader(file);
+            if (reader.isSupported()) {
+                serv = new KService(reader);
+            } else {
+                qCDebug(SYCOCA) << "Falling back to KDesktopFile for" << file;
+            }
+        }
+        if (!serv) {
+            serv = new KService(file);
+        }
 
         qCDebug(SYCOCA) << "Creating KService from" << file << "entryPath=" << serv->entryPath();
         // Note that the menuId will be set by the vfolder_menu.cpp code just after
@@ -123,6 +136,7 @@ void KBuildServiceFactory::save(QDataStream &str)
 
 void KBuildServiceFactory::collectInheritedServices()
 {
+    KBuildSycocaProfiler::Span span("collectInheritedServices");
     // For each MIME type, go up the parent MIME type chains and collect offers.
     // For "removed associations" to work, we can't just grab everything from all parents.
     // We need to process parents before children, hence the recursive call in
@@ -165,6 +179,7 @@ void KBuildServiceFactory::collectInheritedServices(const QString &mimeTypeName,
 
 void KBuildServiceFactory::postProcessServices()
 {
+    KBuildSycocaProfiler::Span span("postProcessServices");
     // By doing all this here rather than in addEntry (and removing when replacing
     // with local override), we only do it for the final applications.
     // Note that this also affects resolution of the by-desktop-name lookup,
@@ -212,6 +227,7 @@ void KBuildServiceFactory::postProcessServices()
 
 void KBuildServiceFactory::populateServiceTypes()
 {
+    KBuildSycocaProfiler::Span span("populateServiceTypes");
     QMimeDatabase db;
     // For every service...
     for (auto servIt = m_entryDict->cbegin(), endIt = m_entryDict->cend(); servIt != endIt; ++servIt) {
@@ -346,6 +362,19 @@ void KBuildServiceFactory::saveOfferList(QDataStream &str)
     str << qint32(0); // End of list marker (0)
 }
 
+QHash<QString, QList<KServiceOffer>> KBuildServiceFactory::sortedOffers() const
+{
+    QHash<QString, QList<KServiceOffer>> result;
+    const auto &offerHash = m_offerHash.serviceTypeData();
+    result.reserve(offerHash.size());
+    for (auto it = offerHash.constBegin(); it != offerHash.constEnd(); ++it) {
+        QList<KServiceOffer> offers = it.value().offers;
+        std::stable_sort(offers.begin(), offers.end()); // by initial preference
+        result.insert(it.key(), offers);
+    }
+    return result;
+}
+
 void KBuildServiceFactory::addEntry(const KSycocaEntry::Ptr &newEntry)
 {
     Q_ASSERT(newEntry);
@@ -69,6 +69,20 @@ public:
 
     void postProcessServices();
 
+    /*!
+     * Returns the offers of every MIME type, sorted the way saveOfferList() writes them.
+     * Used by kbuildsycoca to compare them with the offer lists of a previous database.
+     */
+    QHash<QString, QList<KServiceOffer>> sortedOffers() const;
+
+    /*!
+     * Use KDesktopEntryReader rather than KDesktopFile to parse desktop files
+     */
+    void setUseDesktopEntryReader(bool use)
+    {
+        m_useDesktopEntryReader = use;
+    }
+
 private:
     void populateServiceTypes();
     void saveOfferList(QDataStream &str);
@@ -83,6 +97,7 @@ private:
     KOfferHash m_offerHash;
 
     KBuildMimeTypeFactory *m_mimeTypeFactory;
+    bool m_useDesktopEntryReader = false;
 };
 
 #endif
@@ -7,6 +7,7 @@
 */
 
 #include "kbuildsycoca_p.h"
+#include "kbuildsycocaprofiler_p.h"
 #include "ksycoca_p.h"
 #include "ksycocaresourcelist_p.h"
 #include "ksycocautils_p.h"
@@ -17,6 +18,8 @@
 #include "kbuildservicefactory_p.h"
 #include "kbuildservicegroupfactory_p.h"
 #include "kctimefactory_p.h"
+#include <KConfigGroup>
+#include <KSharedConfig>
 #include <QDataStream>
 #include <QDateTime>
 #include <QDebug>
@@ -26,6 +29,8 @@
 #include <QFile>
 #include <QLocale>
 #include <QSaveFile>
+#include <QScopedValueRollback>
+#include <QThreadPool>
 #include <QTimer>
 #include <config-ksycoca.h>
 #include <kservice.h>
@@ -37,6 +42,8 @@
 #include <QStandardPaths>
 #include <qplatformdefs.h>
 
+#include <functional>
+
 static const char *s_cSycocaPath = nullptr;
 
 KBuildSycocaInterface::~KBuildSycocaInterface()
@@ -55,6 +62,8 @@ KBuildSycoca::KBuildSycoca()
     , m_menuTest(false)
     , m_changed(false)
 {
+    KConfigGroup config(KSharedConfig::openConfig(), QStringLiteral("KSycoca"));
+    m_deltaUpdates = config.readEntry("deltaUpdates", false);
 }
 
 KBuildSycoca::~KBuildSycoca()
@@ -68,7 +77,7 @@ KSycocaEntry::Ptr KBuildSycoca::createEntry(KSycocaFactory *currentFactory, cons
 {
     quint32 timeStamp = m_ctimeFactory->dict()->ctime(file, m_resource);
     if (!timeStamp) {
-        timeStamp = calcResourceHash(m_resourceSubdir, file);
+        timeStamp = resourceHash(m_resourceSubdir, file);
         if (!timeStamp) { // file disappeared meanwhile
             qCDebug(SYCOCA) << "Couldn't generate timeStamp. Has the file disappeared?";
             return {};
@@ -98,17 +107,26 @@ KSycocaEntry::Ptr KBuildSycoca::createEntry(KSycocaFactory *currentFactory, cons
             m_ctimeDict->remove(file, m_resource);
         } else if (oldTimestamp) {
             m_changed = true;
+            m_changedResources.insert(m_resource);
             m_ctimeDict->remove(file, m_resource);
             qCDebug(SYCOCA) << "modified:" << file;
         } else {
             m_changed = true;
+            m_changedResources.insert(m_resource);
             qCDebug(SYCOCA) << "new:" << file;
         }
     }
     m_ctimeFactory->dict()->addCTime(file, m_resource, timeStamp);
     if (!entry) {
-        // Create a new entry
-        entry = currentFactory->createEntry(file);
+        // Create a new entry, unless preparseServices() already did
+        auto it = m_preparsedServices.find(file);
+        if (it != m_preparsedServices.end() && currentFactory == d->m_serviceFactory) {
+            entry = it.value();
+            m_preparsedServices.erase(it);
+        } else {
+            KBuildSycocaProfiler::Span span("parse file", file);
+            entry = currentFactory->createEntry(file);
+        }
     }
     if (entry && entry->isValid()) {
         return entry;
@@ -126,6 +144,83 @@ KService::Ptr KBuildSycoca::createService(const QString &path)
     return KService::Ptr(static_cast<KService *>(entry.data()));
 }
 
+void KBuildSycoca::preparseServices()
+{
+    KBuildSycocaProfiler::Span span("preparseServices");
+    // Same traversal (and paths) as VFolderMenu::loadApplications, which will then call createService() for these files.
+    // Files found only via other paths (legacy dirs, custom <AppDir>s) are simply parsed on demand.
+    QStringList files;
+    auto addFile = [&](const QString &file) {
+        // Skip what createEntry() will reuse from the previous database
+        if (m_allEntries && m_ctimeDict->ctime(file, m_resource) == resourceHash(m_resourceSubdir, file)) {
+            return;
+        }
+        files.append(file);
+    };
+    std::function<void(const QString &)> collect = [&](const QString &dir) {
+        if (const KSycocaDirectoryScan::Entry *dirEntry = m_directoryScan.entry(dir)) {
+            for (const QString &fn : dirEntry->children) {
+                const QString path = KSycocaDirectoryScan::childPath(dir, fn);
+                const KSycocaDirectoryScan::Entry *child = m_directoryScan.entry(path);
+                if (child->isDir && !child->isSymLink) {
+                    collect(path);
+                } else if (child->isFile && fn.endsWith(QLatin1String(".desktop"))) {
+                    addFile(path);
+                }
+            }
+            return;
+        }
+        QDirIterator it(dir);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo fi = it.fileInfo();
+            const QString fn = fi.fileName();
+            if (fi.isDir() && !fi.isSymLink() && !fi.isBundle()) { // same check as in ksycocautils_p.h
+                if (fn != QLatin1String(".") && fn != QLatin1String("..")) {
+                    collect(fi.filePath());
+                }
+            } else if (fi.isFile() && fn.endsWith(QLatin1String(".desktop"))) {
+                addFile(fi.absoluteFilePath());
+            }
+        }
+    };
+    const QStringList dirs = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, m_resourceSubdir, QStandardPaths::LocateDirectory);
+    for (const QString &dir : dirs) {
+        collect(dir);
+    }
+
+    // Parsing a file is cheap, don't bother with threads for a few of them
+    const qsizetype chunkSize = 32;
+    if (files.size() < 2 * chunkSize) {
+        return;
+    }
+
+    qCDebug(SYCOCA) << "Parsing" << files.size() << "desktop files in parallel";
+    QList<KSycocaEntry *> parsed(files.size(), nullptr);
+    KSycocaEntry **out = parsed.data();
+    const KSycocaFactory *serviceFactory = d->m_serviceFactory;
+    // createEntry() is safe to call from several threads: every file gets its own KDesktopFile (or KDesktopEntryReader)
+    // and KService, and KServicePrivate::init only reads the file, without looking anything up in ksycoca
+    // or in the global config.
+    QThreadPool pool;
+    for (qsizetype begin = 0; begin < files.size(); begin += chunkSize) {
+        const qsizetype end = std::min(begin + chunkSize, files.size());
+        pool.start([serviceFactory, &files, out, begin, end] {
+            for (qsizetype i = begin; i < end; ++i) {
+                KBuildSycocaProfiler::Span span("parse file", files.at(i));
+                out[i] = serviceFactory->createEntry(files.at(i));
+            }
+        });
+    }
+    pool.waitForDone();
+
+    // Keep invalid files too (as null), so that they aren't parsed a second time
+    m_preparsedServices.reserve(files.size());
+    for (qsizetype i = 0; i < files.size(); ++i) {
+        m_preparsedServices.insert(files.at(i), KSycocaEntry::Ptr(parsed.at(i)));
+    }
+}
+
 // returns false if the database is up to date, true if it needs to be saved
 bool KBuildSycoca::build()
 {
@@ -157,19 +252,24 @@ bool KBuildSycoca::build()
 
     // Save the mtime of each dir, just before we list them
     // ## should we convert to UTC to avoid surprises when summer time kicks in?
+    // The directory scan then answers the listings and file timestamps below, instead of many stat() calls.
     const auto lstDirs = factoryResourceDirs();
-    for (const QString &dir : lstDirs) {
-        qint64 stamp = 0;
-        KSycocaUtilsPrivate::visitResourceDirectory(dir, [&stamp](const QFileInfo &info) {
-            stamp = qMax(stamp, info.lastModified().toMSecsSinceEpoch());
-            return true;
-        });
-        m_allResourceDirs.insert(dir, stamp);
+    m_dataDirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+    {
+        KBuildSycocaProfiler::Span span("directory scan");
+        m_directoryScan.scan(lstDirs);
+        for (const QString &dir : lstDirs) {
+            m_allResourceDirs.insert(dir, directoryStamp(dir));
+        }
     }
 
     const auto lstFiles = factoryExtraFiles();
     for (const QString &file : lstFiles) {
-        m_extraFiles.insert(file, QFileInfo(file).lastModified().toMSecsSinceEpoch());
+        qint64 stamp = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+        if (stamp == 0 || m_contentHash.isEnabledForAllFiles()) {
+            stamp = KSycocaContentHash::fileStamp(file);
+        }
+        m_extraFiles.insert(file, stamp);
     }
 
     QMap<QString, QByteArray> allResourcesSubDirs; // dirs, kstandarddirs-resource-name
@@ -190,11 +290,17 @@ bool KBuildSycoca::build()
         m_changed = false;
         m_resourceSubdir = it1.key();
         m_resource = it1.value();
+        KBuildSycocaProfiler::Span span("createEntry loop", m_resourceSubdir);
 
         QSet<QString> relFiles;
         const QStringList dirs = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, m_resourceSubdir, QStandardPaths::LocateDirectory);
         qCDebug(SYCOCA) << "Looking for subdir" << m_resourceSubdir << "=>" << dirs;
         for (const QString &dir : dirs) {
+            if (m_directoryScan.contains(dir)) {
+                const QStringList relPaths = m_directoryScan.relativePaths(dir);
+                relFiles.unite(QSet<QString>(relPaths.cbegin(), relPaths.cend()));
+                continue;
+            }
             QDirIterator it(dir, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
             while (it.hasNext()) {
                 const QString filePath = it.next();
@@ -238,16 +344,28 @@ bool KBuildSycoca::build()
         m_currentEntryDict = serviceEntryDict;
         m_changed = false;
 
+        if (m_parallelParsing) {
+            preparseServices();
+        }
+
         m_vfolder = new VFolderMenu(d->m_serviceFactory, this);
         if (!m_trackId.isEmpty()) {
             m_vfolder->setTrackId(m_trackId);
         }
 
-        VFolderMenu::SubMenu *kdeMenu = m_vfolder->parseMenu(QStringLiteral("applications.menu"));
+        VFolderMenu::SubMenu *kdeMenu = nullptr;
+        {
+            KBuildSycocaProfiler::Span span("VFolderMenu::parseMenu");
+            kdeMenu = m_vfolder->parseMenu(QStringLiteral("applications.menu"));
+        }
+        m_preparsedServices.clear(); // files which the menu didn't ask for
 
         KServiceGroup::Ptr entry = m_buildServiceGroupFactory->addNew(QStringLiteral("/"), kdeMenu->directoryFile, KServiceGroup::Ptr(), false);
         entry->setLayoutInfo(kdeMenu->layoutList);
-        createMenu(QString(), QString(), kdeMenu);
+        {
+            KBuildSycocaProfiler::Span span("createMenu");
+            createMenu(QString(), QString(), kdeMenu);
+        }
 
         // Storing the mtime *after* looking at these dirs is a tiny race condition,
         // but I'm not sure how to get the vfolder dirs upfront...
@@ -257,12 +375,7 @@ bool KBuildSycoca::build()
                 dir.chop(1); // remove trailing slash, to avoid having ~/.local/share/applications twice
             }
             if (!m_allResourceDirs.contains(dir)) {
-                qint64 stamp = 0;
-                KSycocaUtilsPrivate::visitResourceDirectory(dir, [&stamp](const QFileInfo &info) {
-                    stamp = qMax(stamp, info.lastModified().toMSecsSinceEpoch());
-                    return true;
-                });
-                m_allResourceDirs.insert(dir, stamp);
+                m_allResourceDirs.insert(dir, directoryStamp(dir));
             }
         }
 
@@ -293,7 +406,7 @@ void KBuildSycoca::createMenu(const QString &caption_, const QString &name_, VFo
         }
         quint32 timeStamp = m_ctimeFactory->dict()->ctime(directoryFile, m_resource);
         if (!timeStamp) {
-            timeStamp = calcResourceHash(m_resourceSubdir, directoryFile);
+            timeStamp = resourceHash(m_resourceSubdir, directoryFile);
         }
 
         KServiceGroup::Ptr entry;
@@ -340,6 +453,13 @@ void KBuildSycoca::createMenu(const QString &caption_, const QString &name_, VFo
     }
 }
 
+struct KBuildSycoca::BuildState {
+    QList<KSycocaEntry::List> entries; // in the same order as m_allEntries
+    KCTimeDict ctimeDict;
+    QString databasePath;
+    qint64 databaseLastModified = 0; // in ms since epoch
+};
+
 bool KBuildSycoca::recreate(bool incremental)
 {
     QFileInfo fi(KSycoca::absoluteFilePath());
@@ -364,19 +484,39 @@ bool KBuildSycoca::recreate(bool incremental)
 
     QByteArray qSycocaPath = QFile::encodeName(path);
     s_cSycocaPath = qSycocaPath.data();
+    KBuildSycocaProfiler::Span span("recreate");
+    m_contentHash.load(path);
+
+    // A long-running kbuildsycoca still has the database it wrote last time open
+    const QDateTime databaseLastModified = QFileInfo(path).lastModified();
+    KSycocaPrivate *current = KSycocaPrivate::self();
+    if (current->databaseStatus != KSycocaPrivate::DatabaseNotOpen && current->m_dbLastModified != databaseLastModified) {
+        current->closeDatabase();
+    }
 
+    const std::shared_ptr<const BuildState> previousBuild = std::move(m_previousBuild);
+    m_buildState.reset();
     m_allEntries = nullptr;
     m_ctimeDict = nullptr;
-    if (incremental && checkGlobalHeader()) {
+    if (incremental && previousBuild && previousBuild->databasePath == path
+        && previousBuild->databaseLastModified == databaseLastModified.toMSecsSinceEpoch() && checkGlobalHeader()) {
+        qCDebug(SYCOCA) << "Reusing the entries of the previous build";
+        m_allEntries = new KSycocaEntryListList(previousBuild->entries);
+        m_ctimeDict = new KCTimeDict(previousBuild->ctimeDict);
+    } else if (incremental && checkGlobalHeader()) {
         qCDebug(SYCOCA) << "Reusing existing ksycoca";
+        KBuildSycocaProfiler::Span span("read previous database");
         KSycoca *oldSycoca = KSycoca::self();
         m_allEntries = new KSycocaEntryListList;
         m_ctimeDict = new KCTimeDict;
+        // Compare with the database as it was built, the delta (if any) is written again from scratch
+        QScopedValueRollback<bool> applyDelta(KSycocaPrivate::self()->m_applyDelta, false);
 
         // Must be in same order as in KBuildSycoca::recreate()!
         m_allEntries->append(KSycocaPrivate::self()->mimeTypeFactory()->allEntries());
         m_allEntries->append(KSycocaPrivate::self()->serviceGroupFactory()->allEntries());
-        m_allEntries->append(KSycocaPrivate::self()->serviceFactory()->allEntries());
+        // Unchanged services are then copied as they are into the new database, instead of being encoded again
+        m_allEntries->append(KSycocaPrivate::self()->serviceFactory()->allEntriesForReuse());
 
         KCTimeFactory *ctimeInfo = new KCTimeFactory(oldSycoca);
         *m_ctimeDict = ctimeInfo->loadDict();
@@ -405,9 +545,18 @@ bool KBuildSycoca::recreate(bool incremental)
     d->m_mimeTypeFactory = buildMimeTypeFactory;
     m_buildServiceGroupFactory = new KBuildServiceGroupFactory(this);
     d->m_serviceGroupFactory = m_buildServiceGroupFactory;
-    d->m_serviceFactory = new KBuildServiceFactory(buildMimeTypeFactory);
+    KBuildServiceFactory *buildServiceFactory = new KBuildServiceFactory(buildMimeTypeFactory);
+    buildServiceFactory->setUseDesktopEntryReader(m_useDesktopEntryReader);
+    d->m_serviceFactory = buildServiceFactory;
 
-    if (build()) { // Parse dirs
+    const bool changed = build(); // Parse dirs
+    if (changed && m_allEntries && m_deltaUpdates && !m_menuTest && saveDelta(path)) {
+        delete str;
+        str = nullptr;
+        database.cancelWriting();
+        KSycocaGeneration::increment(path);
+        qCDebug(SYCOCA) << "Saved a delta instead of a new database";
+    } else if (changed) {
         save(str); // Save database
         if (str->status() != QDataStream::Ok) { // Probably unnecessary now in Qt5, since QSaveFile detects write errors
             database.cancelWriting(); // Error
@@ -432,10 +581,14 @@ bool KBuildSycoca::recreate(bool incremental)
         }
 #endif
 
+        KBuildSycocaProfiler::Span commitSpan("QSaveFile::commit");
         if (!database.commit()) {
             qCWarning(SYCOCA) << "ERROR writing database" << database.fileName() << database.errorString();
             return false;
         }
+        // The new database contains all the changes
+        QFile::remove(KSycocaDelta::filePath(path));
+        KSycocaGeneration::increment(path);
     } else {
         delete str;
         str = nullptr;
@@ -452,6 +605,21 @@ bool KBuildSycoca::recreate(bool incremental)
     }
 #endif
 
+    if (!m_menuTest) {
+        m_contentHash.save(path);
+
+        auto state = std::make_shared<BuildState>();
+        for (KSycocaFactory *factory : std::as_const(*factories())) {
+            if (factory != m_ctimeFactory) {
+                state->entries.append(factory->entryDict()->values());
+            }
+        }
+        state->ctimeDict = *m_ctimeFactory->dict();
+        state->databasePath = path;
+        state->databaseLastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+        m_buildState = std::move(state);
+    }
+
     delete m_ctimeDict;
     delete m_allEntries;
     delete m_vfolder;
@@ -459,8 +627,26 @@ bool KBuildSycoca::recreate(bool incremental)
     return true;
 }
 
+// For the profiler
+static QString factoryName(KSycocaFactoryId id)
+{
+    switch (id) {
+    case KST_KServiceFactory:
+        return QStringLiteral("services");
+    case KST_KServiceGroupFactory:
+        return QStringLiteral("service groups");
+    case KST_KMimeTypeFactory:
+        return QStringLiteral("mime types");
+    case KST_CTimeInfo:
+        return QStringLiteral("timestamps");
+    default:
+        return QString::number(id);
+    }
+}
+
 void KBuildSycoca::save(QDataStream *str)
 {
+    KBuildSycocaProfiler::Span span("save");
     // Write header (#pass 1)
     str->device()->seek(0);
 
@@ -490,7 +676,7 @@ void KBuildSycoca::save(QDataStream *str)
     (*str) << m_newTimestamp;
     (*str) << QLocale().bcp47Name();
     // This makes it possible to trigger a ksycoca update for all users (KIOSK feature)
-    (*str) << calcResourceHash(QStringLiteral("kservices6"), QStringLiteral("update_ksycoca"));
+    (*str) << calcResourceHash(QStringLiteral("kservices6"), QStringLiteral("update_ksycoca"), &m_contentHash);
     (*str) << m_allResourceDirs.keys();
     for (auto it = m_allResourceDirs.constBegin(); it != m_allResourceDirs.constEnd(); ++it) {
         (*str) << it.value();
@@ -511,6 +697,7 @@ void KBuildSycoca::save(QDataStream *str)
     // Write factory data....
     lst = *factories();
     for (KSycocaFactory *factory : std::as_const(lst)) {
+        KBuildSycocaProfiler::Span factorySpan("factory save", factoryName(factory->factoryId()));
         factory->save(*str);
         if (str->status() != QDataStream::Ok) { // ######## TODO: does this detect write errors, e.g. disk full?
             return; // error
@@ -538,6 +725,195 @@ void KBuildSycoca::save(QDataStream *str)
     str->device()->seek(endOfData);
 }
 
+namespace
+{
+// Everything the dictionaries of the service groups are built from
+bool sameLookupKeys(const KSycocaEntry::Ptr &oldEntry, const KSycocaEntry::Ptr &newEntry)
+{
+    if (oldEntry->sycocaType() != newEntry->sycocaType() || oldEntry->entryPath() != newEntry->entryPath()) {
+        return false;
+    }
+    if (oldEntry->isType(KST_KServiceGroup)) {
+        const auto *oldGroup = static_cast<const KServiceGroup *>(oldEntry.data());
+        const auto *newGroup = static_cast<const KServiceGroup *>(newEntry.data());
+        return oldGroup->baseGroupName() == newGroup->baseGroupName();
+    }
+    return false;
+}
+
+// The keys of the dictionary slots a service can occupy
+void addLookupKeys(const KService *service, QSet<QString> *desktopNames, QSet<QString> *desktopPaths, QSet<QString> *menuIds)
+{
+    desktopNames->insert(service->desktopEntryName());
+    desktopPaths->insert(service->entryPath());
+    if (!service->menuId().isEmpty()) {
+        menuIds->insert(service->menuId());
+    }
+}
+}
+
+bool KBuildSycoca::saveDelta(const QString &path)
+{
+    KBuildSycocaProfiler::Span span("saveDelta");
+    static const int s_maxDeltaRecords = 64; // beyond that, compact into a new database
+
+    KSycocaPrivate *oldSycoca = KSycocaPrivate::self();
+    // Only changes to applications, menus and mimeapps.list files can be expressed as a delta
+    QSet<QByteArray> resources = m_changedResources;
+    resources.unite(m_ctimeDict->resources()); // removed files
+    resources.remove("apps");
+    if (!resources.isEmpty()) {
+        qCDebug(SYCOCA) << "No delta update, changed resources:" << resources;
+        return false;
+    }
+    if (m_allResourceDirs.keys() != oldSycoca->allResourceDirs.keys()) {
+        qCDebug(SYCOCA) << "No delta update, the list of directories changed";
+        return false;
+    }
+
+    // Compare with the entries as they are in the database, without the previous delta
+    QScopedValueRollback<bool> applyDelta(oldSycoca->m_applyDelta, false);
+    KSycocaDelta delta;
+
+    // Services: added ones get offsets past the end of the database
+    KServiceFactory *oldServiceFactory = oldSycoca->serviceFactory();
+    auto *newServiceFactory = static_cast<KBuildServiceFactory *>(d->m_serviceFactory);
+    const KSycocaEntryDict &newServices = *newServiceFactory->entryDict();
+    const KSycocaEntry::List oldServices = oldServiceFactory->allEntries();
+    QHash<QString, qint32> serviceOffsets; // storage id -> offset in the database or in the delta
+    QList<qint32> offsets;
+    offsets.reserve(oldServices.size());
+    for (const KSycocaEntry::Ptr &oldEntry : oldServices) {
+        serviceOffsets.insert(oldEntry->storageId(), oldEntry->offset());
+        offsets.append(oldEntry->offset());
+    }
+
+    // Only the dictionary slots of added, changed or removed services can change
+    QSet<QString> desktopNames;
+    QSet<QString> desktopPaths;
+    QSet<QString> menuIds;
+    const QHash<qint32, QByteArray> oldRecords = oldServiceFactory->entryRecords(offsets);
+    for (const KSycocaEntry::Ptr &oldEntry : oldServices) {
+        if (!newServices.contains(oldEntry->storageId())) {
+            delta.setRecord(oldEntry->offset(), QByteArray());
+            delta.setDictSlot(KSycocaDelta::StorageIdDict, oldEntry->storageId(), 0);
+            addLookupKeys(static_cast<KService *>(oldEntry.data()), &desktopNames, &desktopPaths, &menuIds);
+        }
+    }
+    qint32 nextOffset = qint32(QFileInfo(path).size());
+    for (auto it = newServices.cbegin(); it != newServices.cend(); ++it) {
+        const auto *newService = static_cast<KService *>(it.value().data());
+        // encodeEntry() changes the offset of reused entries, which is fine since they're not saved again
+        const QByteArray record = KSycocaFactory::encodeEntry(it.value());
+        const qint32 offset = serviceOffsets.value(it.key());
+        if (!offset) {
+            serviceOffsets.insert(it.key(), nextOffset);
+            delta.addRecord(nextOffset, record);
+            delta.setDictSlot(KSycocaDelta::StorageIdDict, it.key(), nextOffset);
+            ++nextOffset;
+        } else if (record != oldRecords.value(offset)) {
+            delta.setRecord(offset, record);
+            KService::Ptr oldService = oldServiceFactory->serviceAtOffset(offset);
+            if (oldService) {
+                addLookupKeys(oldService.data(), &desktopNames, &desktopPaths, &menuIds);
+            }
+        } else {
+            continue;
+        }
+        addLookupKeys(newService, &desktopNames, &desktopPaths, &menuIds);
+    }
+
+    auto compareSlots = [&](KSycocaDelta::Dict dict, const QSet<QString> &keys, KService::Ptr (KServiceFactory::*find)(const QString &)) {
+        for (const QString &key : keys) {
+            const KService::Ptr oldService = (oldServiceFactory->*find)(key);
+            const KService::Ptr newService = (newServiceFactory->*find)(key);
+            const qint32 oldOffset = oldService ? oldService->offset() : 0;
+            const qint32 newOffset = newService ? serviceOffsets.value(newService->storageId()) : 0;
+            if (oldOffset != newOffset) {
+                delta.setDictSlot(dict, key, newOffset);
+            }
+        }
+    };
+    compareSlots(KSycocaDelta::DesktopNameDict, desktopNames, &KServiceFactory::findServiceByDesktopName);
+    compareSlots(KSycocaDelta::DesktopPathDict, desktopPaths, &KServiceFactory::findServiceByDesktopPath);
+    compareSlots(KSycocaDelta::MenuIdDict, menuIds, &KServiceFactory::findServiceByMenuId);
+
+    // Offer lists, which also change with the mimeapps.list files
+    QHash<QString, QPair<qint32, qint32>> oldMimeTypes; // name -> offset, offset in the offer list or -1
+    const KSycocaEntry::List oldMimeTypeEntries = oldSycoca->mimeTypeFactory()->allEntries();
+    for (const KSycocaEntry::Ptr &entry : oldMimeTypeEntries) {
+        const auto *mimeType = static_cast<const KMimeTypeFactory::MimeTypeEntry *>(entry.data());
+        oldMimeTypes.insert(mimeType->name(), {mimeType->offset(), mimeType->serviceOffersOffset()});
+    }
+    const QHash<QString, QList<KServiceOffer>> newOffers = newServiceFactory->sortedOffers();
+    for (auto it = newOffers.cbegin(); it != newOffers.cend(); ++it) {
+        const auto oldMimeType = oldMimeTypes.constFind(it.key());
+        if (oldMimeType == oldMimeTypes.cend()) {
+            qCDebug(SYCOCA) << "No delta update, new MIME type" << it.key();
+            return false;
+        }
+        QList<KSycocaDelta::Offer> offers;
+        offers.reserve(it.value().size());
+        for (const KServiceOffer &offer : it.value()) {
+            const qint32 serviceOffset = serviceOffsets.value(offer.service()->storageId());
+            if (!serviceOffset) {
+                qCDebug(SYCOCA) << "No delta update, unknown service" << offer.service()->storageId() << "offered for" << it.key();
+                return false;
+            }
+            offers.append({serviceOffset, offer.mimeTypeInheritanceLevel()});
+        }
+        if (offers != oldServiceFactory->offerRecords(oldMimeType->first, oldMimeType->second)) {
+            delta.setOffers(oldMimeType->first, offers);
+        }
+    }
+    for (auto it = oldMimeTypes.cbegin(); it != oldMimeTypes.cend(); ++it) {
+        if (it->second != -1 && !newOffers.contains(it.key())) {
+            delta.setOffers(it->first, {});
+        }
+    }
+
+    // Service groups, which refer to their services by entry path
+    const KSycocaEntryDict &newGroups = *m_buildServiceGroupFactory->entryDict();
+    const KSycocaEntry::List oldGroups = oldSycoca->serviceGroupFactory()->allEntries();
+    offsets.clear();
+    QSet<QString> oldGroupIds;
+    for (const KSycocaEntry::Ptr &oldEntry : oldGroups) {
+        offsets.append(oldEntry->offset());
+        oldGroupIds.insert(oldEntry->storageId());
+    }
+    for (auto it = newGroups.cbegin(); it != newGroups.cend(); ++it) {
+        if (!oldGroupIds.contains(it.key())) {
+            qCDebug(SYCOCA) << "No delta update, new menu" << it.key();
+            return false;
+        }
+    }
+    const QHash<qint32, QByteArray> oldGroupRecords = oldSycoca->serviceGroupFactory()->entryRecords(offsets);
+    for (const KSycocaEntry::Ptr &oldEntry : oldGroups) {
+        const qint32 offset = oldEntry->offset();
+        const KSycocaEntry::Ptr newEntry = newGroups.value(oldEntry->storageId());
+        if (!newEntry) {
+            delta.setRecord(offset, QByteArray());
+            continue;
+        }
+        if (!sameLookupKeys(oldEntry, newEntry)) {
+            qCDebug(SYCOCA) << "No delta update, the lookup keys of" << oldEntry->storageId() << "changed";
+            return false;
+        }
+        const QByteArray record = KSycocaFactory::encodeEntry(newEntry);
+        if (record != oldGroupRecords.value(offset)) {
+            delta.setRecord(offset, record);
+        }
+    }
+
+    if (delta.recordCount() > s_maxDeltaRecords) {
+        qCDebug(SYCOCA) << "No delta update," << delta.recordCount() << "changed entries";
+        return false;
+    }
+    delta.allResourceDirs = m_allResourceDirs;
+    delta.extraFiles = m_extraFiles;
+    return delta.save(path, QFileInfo(path).lastModified().toMSecsSinceEpoch());
+}
+
 QStringList KBuildSycoca::factoryResourceDirs()
 {
     static QStringList *dirs = nullptr;
@@ -552,6 +928,11 @@ QStringList KBuildSycoca::factoryResourceDirs()
     return *dirs;
 }
 
+bool KBuildSycoca::usesMemFdStrategy() const
+{
+    return d->m_sycocaStrategy == KSycocaPrivate::StrategyMemFd;
+}
+
 QStringList KBuildSycoca::factoryExtraFiles()
 {
     QStringList files;
@@ -579,20 +960,40 @@ QStringList KBuildSycoca::existingResourceDirs()
     return *dirs;
 }
 
-static quint32 updateHash(const QString &file, quint32 hash)
+static bool useContentHash(qint64 timestamp, const KSycocaContentHash *contentHash)
+{
+    // On some systems (i.e. Fedora Kinoite), all files in /usr have a last
+    // modified timestamp of 0 (UNIX Epoch). Compare their contents instead.
+    return timestamp == 0 || contentHash->isEnabledForAllFiles();
+}
+
+static quint32 addTimestamp(const QString &file, qint64 timestamp, quint32 hash, KSycocaContentHash *contentHash)
+{
+    if (useContentHash(timestamp, contentHash)) {
+        return hash + contentHash->fileHash(file);
+    }
+    return hash + timestamp;
+}
+
+static quint32 updateHash(const QString &file, quint32 hash, KSycocaContentHash *contentHash)
 {
     QFileInfo fi(file);
     if (fi.isReadable() && fi.isFile()) {
         // This was using buff.st_ctime (in Waldo's initial commit to kstandarddirs.cpp in 2001), but that looks wrong?
         // Surely we want to catch manual editing, while a chmod doesn't matter much?
-        qint64 timestamp = fi.fileTime(QFile::FileModificationTime, QTimeZone::utc()).toSecsSinceEpoch();
+        hash = addTimestamp(file, fi.fileTime(QFile::FileModificationTime, QTimeZone::utc()).toSecsSinceEpoch(), hash, contentHash);
+    }
+    return hash;
+}
 
-        // On some systems (i.e. Fedora Kinoite), all files in /usr have a last
-        // modified timestamp of 0 (UNIX Epoch). In this case, always assume
-        // the file as been changed.
-        if (timestamp == 0) {
-            static qint64 now = QDateTime::currentSecsSinceEpoch();
-            timestamp = now;
+// Same as updateHash, from the directory scan
+static quint32 updateHash(const KSycocaDirectoryScan::Entry *entry, const QString &file, quint32 hash, KSycocaContentHash *contentHash)
+{
+    if (entry && entry->readable && entry->isFile) {
+        const qint64 timestamp = entry->mtime / 1000;
+        if (useContentHash(timestamp, contentHash)) {
+            // Without another stat(), the scan has what the cache of hashes is keyed on
+            return hash + contentHash->fileHash(file, entry->inode, entry->size, entry->mtimeNSecs, entry->ctimeNSecs);
         }
         hash += timestamp;
     }
@@ -600,17 +1001,23 @@ static quint32 updateHash(const QString &file, quint32 hash)
 }
 
 quint32 KBuildSycoca::calcResourceHash(const QString &resourceSubDir, const QString &filename)
+{
+    KSycocaContentHash contentHash;
+    return calcResourceHash(resourceSubDir, filename, &contentHash);
+}
+
+quint32 KBuildSycoca::calcResourceHash(const QString &resourceSubDir, const QString &filename, KSycocaContentHash *contentHash)
 {
     quint32 hash = 0;
     if (!QDir::isRelativePath(filename)) {
-        return updateHash(filename, hash);
+        return updateHash(filename, hash, contentHash);
     }
     const QString filePath = resourceSubDir + QLatin1Char('/') + filename;
     const QString qrcFilePath = QStringLiteral(":/") + filePath;
     const QStringList files =
         QFileInfo::exists(qrcFilePath) ? QStringList{qrcFilePath} : QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, filePath);
     for (const QString &file : files) {
-        hash = updateHash(file, hash);
+        hash = updateHash(file, hash, contentHash);
     }
     if (hash == 0 && !filename.endsWith(QLatin1String("update_ksycoca"))
         && !filename.endsWith(QLatin1String(".directory")) // bug? needs investigation from someone who understands the VFolder spec
@@ -626,11 +1033,54 @@ quint32 KBuildSycoca::calcResourceHash(const QString &resourceSubDir, const QStr
     return hash;
 }
 
+quint32 KBuildSycoca::resourceHash(const QString &resourceSubDir, const QString &filename) const
+{
+    if (!QDir::isRelativePath(filename)) {
+        if (m_directoryScan.covers(filename)) {
+            return updateHash(m_directoryScan.entry(filename), filename, 0, &m_contentHash);
+        }
+        return calcResourceHash(resourceSubDir, filename, &m_contentHash);
+    }
+    const QString filePath = resourceSubDir + QLatin1Char('/') + filename;
+    if (QFileInfo::exists(QStringLiteral(":/") + filePath)) {
+        return calcResourceHash(resourceSubDir, filename, &m_contentHash);
+    }
+    // Equivalent to locateAll(), as long as all the candidates are in scanned dirs
+    quint32 hash = 0;
+    for (const QString &dataDir : m_dataDirs) {
+        const QString file = dataDir + QLatin1Char('/') + filePath;
+        if (!m_directoryScan.covers(file)) {
+            return calcResourceHash(resourceSubDir, filename, &m_contentHash);
+        }
+        hash = updateHash(m_directoryScan.entry(file), file, hash, &m_contentHash);
+    }
+    return hash;
+}
+
+qint64 KBuildSycoca::directoryStamp(const QString &dir) const
+{
+    qint64 stamp = 0;
+    if (m_directoryScan.contains(dir)) {
+        // Recurse only for services and menus, see visitResourceDirectory
+        stamp = m_directoryScan.directoryStamp(dir, !dir.contains(QLatin1String("/applications")));
+    } else {
+        KSycocaUtilsPrivate::visitResourceDirectory(dir, [&stamp](const QFileInfo &info) {
+            stamp = qMax(stamp, info.lastModified().toMSecsSinceEpoch());
+            return true;
+        });
+    }
+    // No file was ever added or removed since 1970? Then the mtimes were reset (ostree), or the dir doesn't exist
+    if (stamp == 0 || m_contentHash.isEnabledForAllFiles()) {
+        return KSycocaContentHash::directoryStamp(dir);
+    }
+    return stamp;
+}
+
 bool KBuildSycoca::checkGlobalHeader()
 {
     // Since it's part of the filename, we are 99% sure that the locale and prefixes will match.
     const QString current_language = QLocale().bcp47Name();
-    const quint32 current_update_sig = KBuildSycoca::calcResourceHash(QStringLiteral("kservices6"), QStringLiteral("update_ksycoca"));
+    const quint32 current_update_sig = calcResourceHash(QStringLiteral("kservices6"), QStringLiteral("update_ksycoca"), &m_contentHash);
     const QString current_prefixes = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).join(QString(QLatin1Char(':')));
 
     const KSycocaHeader header = KSycocaPrivate::self()->readSycocaHeader();
@@ -9,12 +9,16 @@
 #define KBUILDSYCOCA_H
 
 #include "kbuildsycocainterface_p.h"
+#include "ksycocacontenthash_p.h"
+#include "ksycocadirectoryscan_p.h"
 
 #include <kservice.h>
 #include <ksycoca.h>
 
 #include "vfolder_menu_p.h"
 
+#include <memory>
+
 class KBuildServiceGroupFactory;
 class QDataStream;
 class KCTimeFactory;
@@ -47,6 +51,81 @@ public:
         m_menuTest = b;
     }
 
+    /*!
+     * Parse the desktop files of the applications dirs on a thread pool before building the menu (the default),
+     * rather than one by one while building it. Turned off by unit tests, to compare the results.
+     */
+    void setParallelParsing(bool b)
+    {
+        m_parallelParsing = b;
+    }
+
+    /*!
+     * Parse desktop files with KDesktopEntryReader instead of KDesktopFile.
+     * Files using KConfig features the reader doesn't support still go through KDesktopFile.
+     */
+    void setUseDesktopEntryReader(bool b)
+    {
+        m_useDesktopEntryReader = b;
+    }
+
+    /*!
+     * When only applications, existing menus or mimeapps.list files changed, write a delta
+     * next to the database instead of a new database, see KSycocaDelta.
+     * Defaults to the deltaUpdates key of the [KSycoca] group in kdeglobals.
+     */
+    void setDeltaUpdates(bool b)
+    {
+        m_deltaUpdates = b;
+    }
+
+    /*!
+     * Compare the contents of all files and directories instead of their modification times,
+     * rather than only of those with a modification time of 0, see KSycocaContentHash.
+     * Defaults to the changeDetection key of the [KSycoca] group in kdeglobals being set to "content".
+     */
+    void setContentChangeDetection(bool b)
+    {
+        m_contentHash.setEnabledForAllFiles(b);
+    }
+
+    /*!
+     * The entries and timestamps parsed by a build
+     */
+    struct BuildState;
+
+    /*!
+     * Returns what the last call to recreate() parsed, or nullptr if it failed
+     */
+    std::shared_ptr<const BuildState> buildState() const
+    {
+        return m_buildState;
+    }
+
+    /*!
+     * Start an incremental build from \a state, as returned by buildState() after a previous build,
+     * instead of reading the entries back from the database.
+     * This is for a long-running kbuildsycoca; the state is ignored if someone else wrote the database meanwhile.
+     * The entries of \a state are modified by the build, so it must not be used again afterwards.
+     */
+    void setPreviousBuild(const std::shared_ptr<const BuildState> &state)
+    {
+        m_previousBuild = state;
+    }
+
+    /*!
+     * Returns the directories whose timestamps the last call to recreate() saved into the database
+     */
+    QStringList resourceDirs() const
+    {
+        return m_allResourceDirs.keys();
+    }
+
+    /*!
+     * Returns true if readers are configured to use the database through a memfd, see KSycocaMemFd
+     */
+    bool usesMemFdStrategy() const;
+
     static QStringList factoryResourceDirs();
     static QStringList factoryExtraFiles();
     static QStringList existingResourceDirs();
@@ -83,6 +162,36 @@ private:
      */
     KService::Ptr createService(const QString &path) override;
 
+    /*!
+     * Parse in parallel the .desktop files of the applications dirs which can't be reused
+     * from the previous database, so that createService() only has to pick up the results.
+     */
+    KSERVICE_NO_EXPORT void preparseServices();
+
+    /*!
+     * Same as calcResourceHash, with the content hashes of \a contentHash
+     */
+    KSERVICE_NO_EXPORT static quint32 calcResourceHash(const QString &subdir, const QString &filename, KSycocaContentHash *contentHash);
+
+    /*!
+     * Same as calcResourceHash, but using the directory scan for the files it covers
+     */
+    KSERVICE_NO_EXPORT quint32 resourceHash(const QString &subdir, const QString &filename) const;
+
+    /*!
+     * Returns the latest mtime of \a dir (and its subdirs, except for applications dirs), in ms since epoch,
+     * or a KSycocaContentHash::directoryStamp() if that doesn't tell anything
+     */
+    KSERVICE_NO_EXPORT qint64 directoryStamp(const QString &dir) const;
+
+    /*!
+     * Implementation of KBuildSycocaInterface
+     */
+    const KSycocaDirectoryScan *directoryScan() const override
+    {
+        return &m_directoryScan;
+    }
+
     /*!
      * Convert a VFolderMenu::SubMenu to KServiceGroups.
      */
@@ -98,6 +207,12 @@ private:
      */
     KSERVICE_NO_EXPORT void save(QDataStream *str);
 
+    /*!
+     * Save the changes since the database at \a path was built as a delta, if possible.
+     * Returns false if a new database must be written instead.
+     */
+    KSERVICE_NO_EXPORT bool saveDelta(const QString &path);
+
     /*!
      * Clear the factories
      */
@@ -112,14 +227,20 @@ private:
         return true;
     }
 
-    QMap<QString, qint64> m_allResourceDirs; // dir, mtime in ms since epoch
-    QMap<QString, qint64> m_extraFiles; // file, mtime in ms since epoch
+    QMap<QString, qint64> m_allResourceDirs; // dir, mtime in ms since epoch or content stamp
+    QMap<QString, qint64> m_extraFiles; // file, mtime in ms since epoch or content stamp
     QString m_trackId;
 
     QByteArray m_resource; // e.g. "services" (old resource name, now only used for the signal, see kctimefactory.cpp)
     QString m_resourceSubdir; // e.g. "mime" (xdgdata subdir)
+    QSet<QByteArray> m_changedResources; // resources with new or modified files, for saveDelta()
+
+    KSycocaDirectoryScan m_directoryScan; // the resource dirs, scanned at the beginning of build()
+    QStringList m_dataDirs; // GenericDataLocation, for resourceHash()
+    mutable KSycocaContentHash m_contentHash; // loaded by recreate()
 
     KSycocaEntry::List m_tempStorage;
+    QHash<QString, KSycocaEntry::Ptr> m_preparsedServices; // absolute path, service (null if invalid)
     typedef QList<KSycocaEntry::List> KSycocaEntryListList;
     KSycocaEntryListList *m_allEntries; // entries from existing ksycoca
     KBuildServiceGroupFactory *m_buildServiceGroupFactory = nullptr;
@@ -131,8 +252,14 @@ private:
     VFolderMenu *m_vfolder = nullptr;
     qint64 m_newTimestamp;
 
+    std::shared_ptr<const BuildState> m_previousBuild;
+    std::shared_ptr<const BuildState> m_buildState;
+
     bool m_menuTest;
     bool m_changed;
+    bool m_useDesktopEntryReader = false;
+    bool m_parallelParsing = true;
+    bool m_deltaUpdates = false;
 };
 
 #endif
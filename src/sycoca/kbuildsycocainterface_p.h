@@ -10,11 +10,18 @@
 
 #include <kservice.h>
 
+class KSycocaDirectoryScan;
+
 class KBuildSycocaInterface
 {
 public:
     virtual ~KBuildSycocaInterface();
     virtual KService::Ptr createService(const QString &path) = 0;
+    // The directories scanned upfront by the builder, if any
+    virtual const KSycocaDirectoryScan *directoryScan() const
+    {
+        return nullptr;
+    }
 };
 
 #endif /* KBUILDSYCOCAINTERFACE_H */
@@ -0,0 +1,181 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kbuildsycocaprofiler_p.h"
+#include "sycocadebug.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+struct Event {
+    const char *name;
+    QString detail;
+    qint64 start; // ns
+    qint64 duration; // ns
+    int thread;
+};
+
+std::atomic<bool> s_enabled{false};
+QElapsedTimer s_clock; // started by setEnabled(true), read-only afterwards
+QMutex s_mutex;
+QList<Event> s_events; // protected by s_mutex
+std::atomic<int> s_threadCount{0};
+
+// Small and stable thread ids, the main thread (which enables the profiler) being 1
+int currentThread()
+{
+    thread_local const int id = ++s_threadCount;
+    return id;
+}
+}
+
+void KBuildSycocaProfiler::setEnabled(bool enabled)
+{
+    if (enabled && !s_clock.isValid()) {
+        currentThread();
+        s_clock.start();
+    }
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool KBuildSycocaProfiler::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+KBuildSycocaProfiler::Span::Span(const char *name, const QString &detail)
+    : m_name(name)
+{
+    if (isEnabled()) {
+        m_detail = detail;
+        m_start = s_clock.nsecsElapsed();
+    }
+}
+
+KBuildSycocaProfiler::Span::~Span()
+{
+    if (m_start < 0) {
+        return;
+    }
+    Event event{m_name, std::move(m_detail), m_start, s_clock.nsecsElapsed() - m_start, currentThread()};
+    QMutexLocker locker(&s_mutex);
+    s_events.append(std::move(event));
+}
+
+QString KBuildSycocaProfiler::summary()
+{
+    QMutexLocker locker(&s_mutex);
+
+    struct Total {
+        const char *name = nullptr;
+        int count = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+    };
+    QHash<QByteArray, Total> totals;
+    QList<const Event *> detailed;
+    for (const Event &event : std::as_const(s_events)) {
+        Total &total = totals[QByteArray(event.name)];
+        total.name = event.name;
+        ++total.count;
+        total.total += event.duration;
+        total.max = std::max(total.max, event.duration);
+        if (!event.detail.isEmpty()) {
+            detailed.append(&event);
+        }
+    }
+    QList<Total> sorted = totals.values();
+    std::sort(sorted.begin(), sorted.end(), [](const Total &a, const Total &b) {
+        return a.total > b.total;
+    });
+
+    const auto ms = [](qint64 ns) {
+        return QString::number(ns / 1e6, 'f', 2);
+    };
+    QString result;
+    QTextStream str(&result);
+    str << qSetFieldWidth(32) << Qt::left << "phase" << qSetFieldWidth(10) << Qt::right << "count" << qSetFieldWidth(14) << "total ms" << "max ms"
+        << qSetFieldWidth(0) << '\n';
+    for (const Total &total : std::as_const(sorted)) {
+        str << qSetFieldWidth(32) << Qt::left << total.name << qSetFieldWidth(10) << Qt::right << total.count << qSetFieldWidth(14) << ms(total.total)
+            << ms(total.max) << qSetFieldWidth(0) << '\n';
+    }
+    str << "(nested phases are included in their parents, and parallel ones add up beyond the wall time)\n";
+
+    // The slowest files (and other items), to find the ones which make the build slow
+    const qsizetype slowestCount = std::min<qsizetype>(15, detailed.size());
+    std::partial_sort(detailed.begin(), detailed.begin() + slowestCount, detailed.end(), [](const Event *a, const Event *b) {
+        return a->duration > b->duration;
+    });
+    if (slowestCount > 0) {
+        str << "\nslowest:\n";
+    }
+    for (qsizetype i = 0; i < slowestCount; ++i) {
+        const Event *event = detailed.at(i);
+        str << qSetFieldWidth(10) << Qt::right << ms(event->duration) << qSetFieldWidth(0) << " ms  " << event->name << ": " << event->detail << '\n';
+    }
+    str.flush();
+    return result;
+}
+
+bool KBuildSycocaProfiler::writeTrace(const QString &fileName)
+{
+    QMutexLocker locker(&s_mutex);
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    // Name the threads, so that the viewer doesn't only show numbers
+    for (int thread = 1; thread <= s_threadCount; ++thread) {
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), thread},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), thread == 1 ? QStringLiteral("main") : QStringLiteral("parser %1").arg(thread - 1)}}},
+        });
+    }
+    for (const Event &event : std::as_const(s_events)) {
+        QJsonObject object{
+            {QStringLiteral("name"), QLatin1String(event.name)},
+            {QStringLiteral("cat"), event.detail.isEmpty() ? QStringLiteral("phase") : QStringLiteral("item")},
+            {QStringLiteral("ph"), QStringLiteral("X")},
+            {QStringLiteral("ts"), event.start / 1000.0}, // in us
+            {QStringLiteral("dur"), event.duration / 1000.0},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), event.thread},
+        };
+        if (!event.detail.isEmpty()) {
+            object.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("detail"), event.detail}});
+        }
+        events.append(object);
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(SYCOCA) << "Couldn't write the trace to" << fileName << ":" << file.errorString();
+        return false;
+    }
+    const QJsonObject trace{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    };
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
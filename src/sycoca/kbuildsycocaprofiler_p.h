@@ -0,0 +1,60 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KBUILDSYCOCAPROFILER_P_H
+#define KBUILDSYCOCAPROFILER_P_H
+
+#include <kservice_export.h>
+
+#include <QString>
+
+/*!
+ * \internal
+ * Records how long the phases of building the database take, and which files they spend it on,
+ * for kbuildsycoca --profile and --trace-file.
+ *
+ * Disabled by default, in which case a Span costs a relaxed atomic load.
+ *
+ * Exported for kbuildsycoca, but not installed.
+ */
+class KSERVICE_EXPORT KBuildSycocaProfiler
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    /*!
+     * Records the time between its construction and destruction as \a name,
+     * e.g. "parse file", with an optional \a detail such as the file name.
+     * \a name must be a string literal.
+     */
+    class KSERVICE_EXPORT Span
+    {
+    public:
+        explicit Span(const char *name, const QString &detail = QString());
+        ~Span();
+
+    private:
+        Q_DISABLE_COPY(Span)
+        const char *const m_name;
+        QString m_detail;
+        qint64 m_start = -1; // in ns since the profiler was enabled, -1 if disabled
+    };
+
+    /*!
+     * Returns a table of the time spent per span name, followed by the slowest spans with a detail
+     */
+    static QString summary();
+
+    /*!
+     * Writes the recorded spans to \a fileName in the Chrome trace event format,
+     * which chrome://tracing, Perfetto or Speedscope can open.
+     */
+    static bool writeTrace(const QString &fileName);
+};
+
+#endif
@@ -37,6 +37,15 @@ void KCTimeDict::remove(const QString &path, const QByteArray &resource)
     m_hash.remove(key(path, resource));
 }
 
+QSet<QByteArray> KCTimeDict::resources() const
+{
+    QSet<QByteArray> result;
+    for (auto it = m_hash.cbegin(), endIt = m_hash.cend(); it != endIt; ++it) {
+        result.insert(it.key().left(it.key().indexOf(QLatin1Char('|'))).toLatin1());
+    }
+    return result;
+}
+
 void KCTimeDict::dump() const
 {
     qCDebug(SYCOCA) << m_hash.keys();
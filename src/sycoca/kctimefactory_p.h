@@ -9,6 +9,7 @@
 #define KCTIME_FACTORY_H
 
 #include <QHash>
+#include <QSet>
 #include <ksycocafactory_p.h>
 
 /*!
@@ -27,6 +28,8 @@ public:
     {
         return m_hash.isEmpty();
     }
+    // The resources of the files in the dict
+    QSet<QByteArray> resources() const;
 
     void load(QDataStream &str);
     void save(QDataStream &str) const;
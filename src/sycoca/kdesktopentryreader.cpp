@@ -0,0 +1,332 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kdesktopentryreader_p.h"
+
+#include <QDir>
+#include <QFile>
+#include <QLocale>
+
+static const QString s_desktopEntryGroup = QStringLiteral("Desktop Entry");
+
+// Same unescaping as KConfigIniBackend: \; and \, are kept for readXdgListEntry
+static QString unescapeValue(QByteArrayView value)
+{
+    if (!value.contains('\\')) {
+        return QString::fromUtf8(value);
+    }
+    QByteArray result;
+    result.reserve(value.size());
+    for (qsizetype i = 0; i < value.size(); ++i) {
+        const char c = value.at(i);
+        if (c != '\\' || i + 1 == value.size()) {
+            result += c;
+            continue;
+        }
+        const char next = value.at(++i);
+        switch (next) {
+        case 's':
+            result += ' ';
+            break;
+        case 't':
+            result += '\t';
+            break;
+        case 'n':
+            result += '\n';
+            break;
+        case 'r':
+            result += '\r';
+            break;
+        case '\\':
+            result += '\\';
+            break;
+        case ';':
+        case ',':
+            result += '\\';
+            result += next;
+            break;
+        case 'x':
+            if (i + 2 < value.size()) {
+                bool ok = false;
+                const int code = value.sliced(i + 1, 2).toInt(&ok, 16);
+                if (ok) {
+                    result += char(code);
+                    i += 2;
+                    break;
+                }
+            }
+            Q_FALLTHROUGH();
+        default:
+            result += '\\';
+            result += next;
+            break;
+        }
+    }
+    return QString::fromUtf8(result);
+}
+
+static bool toBool(const QString &value, bool aDefault)
+{
+    if (value.isEmpty()) {
+        return aDefault;
+    }
+    // Same as KConfigGroup::readEntry(key, bool)
+    const QString lower = value.toLower();
+    return !(lower == QLatin1String("false") || lower == QLatin1String("no") || lower == QLatin1String("off") || lower == QLatin1String("0"));
+}
+
+KDesktopEntryReader::KDesktopEntryReader(const QString &fileName)
+    : m_fileName(fileName)
+{
+    const QString localeName = QLocale().name();
+    m_locale = localeName.toUtf8();
+    m_language = m_locale.left(m_locale.indexOf('_'));
+
+    QFile file(fileName);
+    if (!QDir::isAbsolutePath(fileName) || !file.open(QIODevice::ReadOnly)) {
+        m_supported = false;
+        return;
+    }
+    const qint64 size = file.size();
+    if (size == 0) {
+        checkSupported();
+        return;
+    }
+    // Mapping avoids copying the file; not every file system supports it though
+    if (const uchar *data = file.map(0, size)) {
+        parse(QByteArrayView(reinterpret_cast<const char *>(data), size));
+        file.unmap(const_cast<uchar *>(data));
+    } else {
+        const QByteArray contents = file.readAll();
+        parse(contents);
+    }
+    if (m_supported) {
+        checkSupported();
+    }
+}
+
+void KDesktopEntryReader::parse(QByteArrayView data)
+{
+    Group::Data *currentGroup = nullptr;
+    qsizetype lineStart = data.startsWith("\xEF\xBB\xBF") ? 3 : 0; // UTF-8 BOM
+    while (lineStart < data.size()) {
+        qsizetype lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0) {
+            lineEnd = data.size();
+        }
+        const QByteArrayView line = data.sliced(lineStart, lineEnd - lineStart).trimmed();
+        lineStart = lineEnd + 1;
+
+        if (line.isEmpty() || line.front() == '#') {
+            continue;
+        }
+        if (line.front() == '[') {
+            const qsizetype end = line.lastIndexOf(']');
+            const QByteArrayView name = line.sliced(1, (end > 0 ? end : line.size()) - 1);
+            if (end < 0 || name.contains("][") || name.startsWith('$')) {
+                // Nested groups or group flags: leave that to KConfig
+                m_supported = false;
+                return;
+            }
+            currentGroup = &m_groups[QString::fromUtf8(name)];
+            continue;
+        }
+        if (!currentGroup) {
+            continue; // entries before the first group, KDesktopFile doesn't look at them either
+        }
+        const qsizetype eq = line.indexOf('=');
+        if (eq <= 0) {
+            continue;
+        }
+        QByteArrayView key = line.first(eq).trimmed();
+        const QByteArrayView value = line.sliced(eq + 1).trimmed();
+        QByteArrayView locale;
+        if (key.endsWith(']')) {
+            const qsizetype open = key.indexOf('[');
+            if (open <= 0 || key.at(open + 1) == '$') {
+                m_supported = false; // [$e], [$i]...
+                return;
+            }
+            locale = key.sliced(open + 1, key.size() - open - 2);
+            key = key.first(open);
+            if (locale.contains('[')) {
+                m_supported = false; // e.g. Name[de][$e]
+                return;
+            }
+        }
+        setEntry(*currentGroup, key, locale, value);
+    }
+}
+
+void KDesktopEntryReader::setEntry(Group::Data &group, QByteArrayView key, QByteArrayView locale, QByteArrayView value)
+{
+    // 0: untranslated, 1: language only, 2: language and country.
+    // Later lines with the same match win, like in KConfig.
+    int match = 0;
+    if (!locale.isEmpty()) {
+        if (locale == m_locale) {
+            match = 2;
+        } else if (locale == m_language) {
+            match = 1;
+        } else {
+            return; // other translation
+        }
+    }
+
+    const QString keyString = QString::fromUtf8(key);
+    const QString valueString = unescapeValue(value);
+    if (match == 0) {
+        auto it = group.localeMatch.constFind(keyString);
+        if (it != group.localeMatch.cend() && it.value() > 0) {
+            group.untranslated.insert(keyString, valueString);
+            return;
+        }
+        group.entries.insert(keyString, valueString);
+        group.localeMatch.insert(keyString, 0);
+        return;
+    }
+
+    auto it = group.localeMatch.find(keyString);
+    if (it == group.localeMatch.end() || it.value() <= match) {
+        if (it == group.localeMatch.end() || it.value() == 0) {
+            // Remember the untranslated value for readEntryUntranslated
+            auto entry = group.entries.constFind(keyString);
+            if (entry != group.entries.cend()) {
+                group.untranslated.insert(keyString, entry.value());
+            }
+        }
+        group.entries.insert(keyString, valueString);
+        group.localeMatch.insert(keyString, match);
+    }
+}
+
+void KDesktopEntryReader::checkSupported()
+{
+    const Group group = desktopGroup();
+    if (!group.m_data) {
+        return; // no [Desktop Entry], KServicePrivate::init will report it as invalid
+    }
+    // These need KAuthorized/user lookups, which KDesktopFile::tryExec() implements
+    if (group.hasKey("X-KDE-AuthorizeAction") || group.hasKey("X-KDE-SubstituteUID")) {
+        m_supported = false;
+        return;
+    }
+    // TryExec is read with readPathEntry, which expands $HOME and friends
+    const QString tryExec = group.readEntry("TryExec");
+    if (tryExec.contains(QLatin1Char('$')) || tryExec.startsWith(QLatin1Char('~'))) {
+        m_supported = false;
+    }
+}
+
+KDesktopEntryReader::Group KDesktopEntryReader::desktopGroup() const
+{
+    auto it = m_groups.constFind(s_desktopEntryGroup);
+    return Group(it != m_groups.cend() ? &it.value() : nullptr);
+}
+
+QString KDesktopEntryReader::readName() const
+{
+    return desktopGroup().readEntry("Name");
+}
+
+bool KDesktopEntryReader::tryExec() const
+{
+    const QString tryExec = desktopGroup().readEntry("TryExec");
+    return tryExec.isEmpty() || !QStandardPaths::findExecutable(tryExec).isEmpty();
+}
+
+QStandardPaths::StandardLocation KDesktopEntryReader::locationType() const
+{
+    // Only used for relative paths by KServicePrivate::init, and this reader only handles absolute paths
+    return QStandardPaths::ApplicationsLocation;
+}
+
+QStringList KDesktopEntryReader::readActions() const
+{
+    return desktopGroup().readXdgListEntry("Actions");
+}
+
+bool KDesktopEntryReader::hasActionGroup(const QString &group) const
+{
+    return m_groups.contains(QLatin1String("Desktop Action ") + group);
+}
+
+KDesktopEntryReader::Group KDesktopEntryReader::actionGroup(const QString &group) const
+{
+    auto it = m_groups.constFind(QLatin1String("Desktop Action ") + group);
+    return Group(it != m_groups.cend() ? &it.value() : nullptr);
+}
+
+QStringList KDesktopEntryReader::splitXdgList(const QString &value)
+{
+    // Same as KConfigGroup::readXdgListEntry
+    QStringList list;
+    QString item;
+    item.reserve(value.size());
+    bool quoted = false;
+    for (const QChar c : value) {
+        if (quoted) {
+            item += c;
+            quoted = false;
+        } else if (c == QLatin1Char('\\')) {
+            quoted = true;
+        } else if (c == QLatin1Char(';')) {
+            list.append(item);
+            item.clear();
+        } else {
+            item += c;
+        }
+    }
+    if (!item.isEmpty()) {
+        list.append(item);
+    }
+    return list;
+}
+
+bool KDesktopEntryReader::Group::hasKey(const char *key) const
+{
+    return m_data && m_data->entries.contains(QLatin1String(key));
+}
+
+QString KDesktopEntryReader::Group::readEntry(const char *key, const QString &aDefault) const
+{
+    if (!m_data) {
+        return aDefault;
+    }
+    return m_data->entries.value(QLatin1String(key), aDefault);
+}
+
+bool KDesktopEntryReader::Group::readEntry(const char *key, bool aDefault) const
+{
+    return toBool(readEntry(key), aDefault);
+}
+
+QString KDesktopEntryReader::Group::readEntryUntranslated(const char *key) const
+{
+    if (!m_data) {
+        return QString();
+    }
+    const QLatin1String keyString(key);
+    auto it = m_data->untranslated.constFind(keyString);
+    if (it != m_data->untranslated.cend()) {
+        return it.value();
+    }
+    if (m_data->localeMatch.value(keyString) > 0) {
+        return QString(); // only a translation is available
+    }
+    return m_data->entries.value(keyString);
+}
+
+QStringList KDesktopEntryReader::Group::readXdgListEntry(const char *key) const
+{
+    return splitXdgList(readEntry(key));
+}
+
+QStringList KDesktopEntryReader::Group::readXdgListEntry(const QString &key) const
+{
+    return m_data ? splitXdgList(m_data->entries.value(key)) : QStringList();
+}
@@ -0,0 +1,108 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KDESKTOPENTRYREADER_P_H
+#define KDESKTOPENTRYREADER_P_H
+
+#include <kservice_export.h>
+
+#include <QHash>
+#include <QMap>
+#include <QStandardPaths>
+#include <QStringList>
+
+/*!
+ * \internal
+ * A single-pass reader for .desktop files, used by kbuildsycoca instead of KDesktopFile.
+ *
+ * The file is read (mapped) once, and only the translations for the current locale are kept,
+ * following the lookup order of the Desktop Entry Specification (lang_COUNTRY, then lang).
+ * Values are unescaped the same way KConfig does, so the results are the same as with KDesktopFile.
+ *
+ * Files using KConfig features which this reader doesn't implement ($e expansion flags,
+ * immutability markers, X-KDE-AuthorizeAction...) are reported as not supported,
+ * the caller must then use KDesktopFile.
+ *
+ * The API mimics the subset of KDesktopFile/KConfigGroup used by KServicePrivate::init().
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KDesktopEntryReader
+{
+public:
+    class Group
+    {
+    public:
+        QMap<QString, QString> entryMap() const
+        {
+            return m_data ? m_data->entries : QMap<QString, QString>();
+        }
+        bool hasKey(const char *key) const;
+        QString readEntry(const char *key, const QString &aDefault = QString()) const;
+        bool readEntry(const char *key, bool aDefault) const;
+        QString readEntryUntranslated(const char *key) const;
+        QStringList readXdgListEntry(const char *key) const;
+        QStringList readXdgListEntry(const QString &key) const;
+
+    private:
+        friend class KDesktopEntryReader;
+        struct Data {
+            QMap<QString, QString> entries; // translated to the current locale
+            QHash<QString, QString> untranslated; // only for translated keys
+            QHash<QString, int> localeMatch; // how well the value in entries matches the locale, see setEntry()
+        };
+        explicit Group(const Data *data)
+            : m_data(data)
+        {
+        }
+        const Data *m_data;
+    };
+
+    /*!
+     * Reads \a fileName, which must be an absolute path.
+     */
+    explicit KDesktopEntryReader(const QString &fileName);
+
+    /*!
+     * Returns false if the file couldn't be read, or uses syntax that only KDesktopFile supports
+     */
+    bool isSupported() const
+    {
+        return m_supported;
+    }
+
+    QString fileName() const
+    {
+        return m_fileName;
+    }
+
+    Group desktopGroup() const;
+    QString readName() const;
+    bool tryExec() const;
+    QStandardPaths::StandardLocation locationType() const;
+    QStringList readActions() const;
+    bool hasActionGroup(const QString &group) const;
+    Group actionGroup(const QString &group) const;
+
+    /*!
+     * Splits a value on unescaped semicolons, like KConfigGroup::readXdgListEntry
+     */
+    static QStringList splitXdgList(const QString &value);
+
+private:
+    void parse(QByteArrayView data);
+    void setEntry(Group::Data &group, QByteArrayView key, QByteArrayView locale, QByteArrayView value);
+    void checkSupported();
+
+    QString m_fileName;
+    QHash<QString, Group::Data> m_groups;
+    QByteArray m_language; // e.g. "de"
+    QByteArray m_locale; // e.g. "de_CH"
+    bool m_supported = true;
+};
+
+#endif
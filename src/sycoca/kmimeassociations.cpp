@@ -6,6 +6,7 @@
 */
 
 #include "kmimeassociations_p.h"
+#include "kbuildsycocaprofiler_p.h"
 #include "sycocadebug.h"
 #include <KConfig>
 #include <KConfigGroup>
@@ -41,6 +42,21 @@ text/plain=kate.desktop;
 */
 
 QStringList KMimeAssociations::mimeAppsFiles()
+{
+    QStringList mimeappsFiles;
+    // collect existing files
+    const QStringList candidates = mimeAppsCandidateFiles();
+    for (const QString &candidate : candidates) {
+        const QFileInfo fileInfo(candidate);
+        const QString filePath = fileInfo.canonicalFilePath();
+        if (!filePath.isEmpty() && !mimeappsFiles.contains(filePath)) {
+            mimeappsFiles.append(filePath);
+        }
+    }
+    return mimeappsFiles;
+}
+
+QStringList KMimeAssociations::mimeAppsCandidateFiles()
 {
     QStringList mimeappsFileNames;
     // make the list of possible filenames from the spec ($desktop-mimeapps.list, then mimeapps.list)
@@ -51,18 +67,14 @@ QStringList KMimeAssociations::mimeAppsFiles()
     }
     mimeappsFileNames.append(QStringLiteral("mimeapps.list"));
     const QStringList mimeappsDirs = mimeAppsDirs();
-    QStringList mimeappsFiles;
-    // collect existing files
+    QStringList candidates;
+    candidates.reserve(mimeappsDirs.size() * mimeappsFileNames.size());
     for (const QString &dir : mimeappsDirs) {
         for (const QString &file : std::as_const(mimeappsFileNames)) {
-            const QFileInfo fileInfo(dir + QLatin1Char('/') + file);
-            const QString filePath = fileInfo.canonicalFilePath();
-            if (!filePath.isEmpty() && !mimeappsFiles.contains(filePath)) {
-                mimeappsFiles.append(filePath);
-            }
+            candidates.append(dir + QLatin1Char('/') + file);
         }
     }
-    return mimeappsFiles;
+    return candidates;
 }
 
 QStringList KMimeAssociations::mimeAppsDirs()
@@ -73,6 +85,7 @@ QStringList KMimeAssociations::mimeAppsDirs()
 
 void KMimeAssociations::parseAllMimeAppsList()
 {
+    KBuildSycocaProfiler::Span span("KMimeAssociations");
     int basePreference = 1000; // start high :)
     const QStringList files = KMimeAssociations::mimeAppsFiles();
     // Global first, then local
@@ -87,6 +100,7 @@ void KMimeAssociations::parseAllMimeAppsList()
 
 void KMimeAssociations::parseMimeAppsList(const QString &file, int basePreference)
 {
+    KBuildSycocaProfiler::Span span("parse mimeapps.list", file);
     KConfig profile(file, KConfig::SimpleConfig);
     if (file.endsWith(QLatin1String("/mimeapps.list"))) { // not for $desktop-mimeapps.list
         parseAddedAssociations(KConfigGroup(&profile, QStringLiteral("Added Associations")), file, basePreference);
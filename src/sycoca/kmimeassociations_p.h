@@ -63,14 +63,18 @@ public:
 
     static QStringList mimeAppsFiles();
 
+    // The paths mimeAppsFiles() looks at, whether they exist or not
+    static QStringList mimeAppsCandidateFiles();
+
+    // The directories of these paths
+    static QStringList mimeAppsDirs();
+
     // Read mimeapps.list files
     void parseAllMimeAppsList();
 
     void parseMimeAppsList(const QString &file, int basePreference);
 
 private:
-    static QStringList mimeAppsDirs();
-
     void parseAddedAssociations(const KConfigGroup &group, const QString &file, int basePreference);
     void parseRemovedAssociations(const KConfigGroup &group, const QString &file);
 
@@ -22,11 +22,15 @@
 #include <QDataStream>
 #include <QFile>
 #include <QFileInfo>
+#include <QLockFile>
 #include <QMetaMethod>
 #include <QStandardPaths>
 #include <QThread>
 #include <QThreadStorage>
 
+#include <atomic>
+#include <mutex>
+
 #include <QCryptographicHash>
 #include <fcntl.h>
 #include <kmimetypefactory_p.h>
@@ -34,7 +38,11 @@
 #include <kservicegroupfactory_p.h>
 
 #include "kbuildsycoca_p.h"
+#include "kmimeassociations_p.h"
+#include "ksycocacontenthash_p.h"
 #include "ksycocadevices_p.h"
+#include "ksycocamemfd_p.h"
+#include "ksycocastatistics_p.h"
 
 #ifdef Q_OS_UNIX
 #include <sys/time.h>
@@ -48,7 +56,7 @@
  * However running apps should still be able to read it, so
  * only add to the data, never remove/modify.
  */
-#define KSYCOCA_VERSION 307
+#define KSYCOCA_VERSION 308
 
 #if HAVE_MADVISE || HAVE_MMAP
 #include <sys/mman.h> // This #include was checked when looking for posix_madvise
@@ -74,6 +82,19 @@ QDataStream &operator>>(QDataStream &in, KSycocaHeader &h)
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(KSycocaPrivate::BehaviorsIfNotFound)
 
+static std::atomic<bool> s_backgroundRebuild{false};
+static std::once_flag s_backgroundRebuildConfigRead; // also set by setBackgroundRebuildEnabled(), which wins over the configuration
+static std::atomic<bool> s_backgroundRebuildRunning{false}; // one at a time for the whole process
+
+static bool isBackgroundRebuildEnabled()
+{
+    std::call_once(s_backgroundRebuildConfigRead, [] {
+        KConfigGroup config(KSharedConfig::openConfig(), QStringLiteral("KSycoca"));
+        s_backgroundRebuild = config.readEntry("backgroundRebuild", false);
+    });
+    return s_backgroundRebuild;
+}
+
 KSycocaPrivate::KSycocaPrivate(KSycoca *qq)
     : databaseStatus(DatabaseNotOpen)
     , readError(false)
@@ -112,6 +133,8 @@ void KSycocaPrivate::setStrategyFromString(const QString &strategy)
         m_sycocaStrategy = StrategyFile;
     } else if (strategy == QLatin1String("sharedmem")) {
         m_sycocaStrategy = StrategyMemFile;
+    } else if (strategy == QLatin1String("memfd")) {
+        m_sycocaStrategy = KSycocaMemFd::isSupported() ? StrategyMemFd : StrategyFile;
     } else if (!strategy.isEmpty()) {
         qCWarning(SYCOCA) << "Unknown sycoca strategy:" << strategy;
     }
@@ -148,6 +171,19 @@ bool KSycocaPrivate::tryMmap()
 #endif // HAVE_MMAP
 }
 
+bool KSycocaPrivate::tryMemFd()
+{
+#if HAVE_MMAP
+    // Published by kbuildsycoca --daemon, see KSycocaMemFd
+    qint64 size = 0;
+    sycoca_mmap = KSycocaMemFd::map(m_databasePath, m_dbLastModified.toMSecsSinceEpoch(), &size);
+    sycoca_size = size;
+    return sycoca_mmap != nullptr;
+#else
+    return false;
+#endif
+}
+
 int KSycoca::version()
 {
     return KSYCOCA_VERSION;
@@ -194,6 +230,7 @@ QString KSycocaPrivate::findDatabase()
     if (info.isReadable()) {
         if (m_haveListeners && m_fileWatcher) {
             m_fileWatcher->addFile(path);
+            m_fileWatcher->addFile(KSycocaDelta::filePath(path));
         }
         return path;
     }
@@ -210,14 +247,17 @@ KSycoca::KSycoca()
     : d(new KSycocaPrivate(this))
 {
     if (d->m_fileWatcher) {
+        auto fileChanged = [this](const QString &path) {
+            if (!d->m_databasePath.isEmpty() && path == KSycocaDelta::filePath(d->m_databasePath)) {
+                d->slotDeltaChanged();
+            } else {
+                d->slotDatabaseChanged();
+            }
+        };
         // We always delete and recreate the DB, so KDirWatch normally emits created
-        connect(d->m_fileWatcher.get(), &KDirWatch::created, this, [this]() {
-            d->slotDatabaseChanged();
-        });
+        connect(d->m_fileWatcher.get(), &KDirWatch::created, this, fileChanged);
         // In some cases, KDirWatch only thinks the file was modified though
-        connect(d->m_fileWatcher.get(), &KDirWatch::dirty, this, [this]() {
-            d->slotDatabaseChanged();
-        });
+        connect(d->m_fileWatcher.get(), &KDirWatch::dirty, this, fileChanged);
     }
 }
 
@@ -246,8 +286,18 @@ bool KSycocaPrivate::openDatabase()
         }
 
         qCDebug(SYCOCA) << "Opening ksycoca from" << m_databasePath;
+        if (m_openedBefore) {
+            KSycocaStatistics::add(KSycoca::Statistics::Reopens);
+        }
+        m_openedBefore = true;
+        // Read before opening the database, so that a newer database written meanwhile is noticed
+        m_generation.open(m_databasePath);
+        m_dbGeneration = m_generation.current();
         m_dbLastModified = QFileInfo(m_databasePath).lastModified();
         result = checkVersion();
+        if (result) {
+            loadDelta();
+        }
     } else { // No database file
         // qCDebug(SYCOCA) << "Could not open ksycoca";
         result = false;
@@ -264,7 +314,7 @@ KSycocaAbstractDevice *KSycocaPrivate::device()
     KSycocaAbstractDevice *device = m_device;
     Q_ASSERT(!m_databasePath.isEmpty());
 #if HAVE_MMAP
-    if (m_sycocaStrategy == StrategyMmap && tryMmap()) {
+    if ((m_sycocaStrategy == StrategyMmap && tryMmap()) || (m_sycocaStrategy == StrategyMemFd && tryMemFd())) {
         device = new KSycocaMmapDevice(sycoca_mmap, sycoca_size);
         if (!device->device()->open(QIODevice::ReadOnly)) {
             delete device;
@@ -272,6 +322,7 @@ KSycocaAbstractDevice *KSycocaPrivate::device()
         }
     }
 #endif
+    // Without a memfd, StrategyMemFd reads the file, as it's meant for when mapping it is undesirable
 #ifndef QT_NO_SHAREDMEMORY
     if (!device && m_sycocaStrategy == StrategyMemFile) {
         device = new KSycocaMemFileDevice(m_databasePath);
@@ -294,6 +345,14 @@ KSycocaAbstractDevice *KSycocaPrivate::device()
     return m_device;
 }
 
+QByteArray KSycocaPrivate::mappedData() const
+{
+    if (!sycoca_mmap || !m_device) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(sycoca_mmap, sycoca_size);
+}
+
 QDataStream *&KSycocaPrivate::stream()
 {
     if (!m_device) {
@@ -329,6 +388,36 @@ void KSycocaPrivate::slotDatabaseChanged()
     }
 }
 
+void KSycocaPrivate::loadDelta()
+{
+    m_delta.load(m_databasePath, m_dbLastModified.toMSecsSinceEpoch());
+}
+
+bool KSycocaPrivate::reloadDeltaIfChanged()
+{
+    if (databaseStatus != DatabaseOK) {
+        return false;
+    }
+    const QFileInfo info(KSycocaDelta::filePath(m_databasePath));
+    const qint64 lastModified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+    if (lastModified == m_delta.lastModified) {
+        return false;
+    }
+    loadDelta();
+    timeStamp = 0; // so that the directory timestamps of the delta are read again
+    return true;
+}
+
+void KSycocaPrivate::slotDeltaChanged()
+{
+    // Unlike a new database, this doesn't require closing the database and recreating the factories:
+    // the delta only adds offsets past the end of the database, and is looked up before its dictionaries.
+    if (reloadDeltaIfChanged()) {
+        qCDebug(SYCOCA) << QThread::currentThread() << "the ksycoca delta changed";
+        QMetaObject::invokeMethod(q, &KSycoca::databaseChanged, Qt::QueuedConnection);
+    }
+}
+
 KMimeTypeFactory *KSycocaPrivate::mimeTypeFactory()
 {
     if (!m_mimeTypeFactory) {
@@ -409,7 +498,10 @@ void KSycocaPrivate::closeDatabase()
 
     databaseStatus = DatabaseNotOpen;
     m_databasePath.clear();
+    m_generation.close();
+    m_delta = KSycocaDelta();
     timeStamp = 0;
+    m_resourceWatcher = nullptr; // the next database may be built from other resources
 }
 
 void KSycoca::addFactory(KSycocaFactory *factory)
@@ -561,6 +653,16 @@ KSycocaHeader KSycocaPrivate::readSycocaHeader()
         extraFiles.insert(fileName, mtime);
     }
 
+    // A delta update stores the directory timestamps and the extra files it saw
+    for (auto it = m_delta.allResourceDirs.cbegin(); it != m_delta.allResourceDirs.cend(); ++it) {
+        if (allResourceDirs.contains(it.key())) {
+            allResourceDirs.insert(it.key(), it.value());
+        }
+    }
+    if (m_delta.isLoaded()) {
+        extraFiles = m_delta.extraFiles;
+    }
+
     str->device()->seek(oldPos);
 
     timeStamp = header.timeStamp;
@@ -591,6 +693,14 @@ public:
             const QString dir = it.key();
             const qint64 lastStamp = it.value();
 
+            if (KSycocaContentHash::isContentStamp(lastStamp)) {
+                if (KSycocaContentHash::directoryStamp(dir) != lastStamp) {
+                    qCDebug(SYCOCA) << "dir contents changed:" << dir;
+                    return false;
+                }
+                continue;
+            }
+
             auto visitor = [&](const QFileInfo &fi) {
                 const QDateTime mtime = fi.lastModified();
                 if (mtime.toMSecsSinceEpoch() > lastStamp) {
@@ -622,6 +732,13 @@ public:
             if (!fi.exists()) {
                 return false;
             }
+            if (KSycocaContentHash::isContentStamp(lastStamp)) {
+                if (KSycocaContentHash::fileStamp(fileName) != lastStamp) {
+                    qCDebug(SYCOCA) << "file replaced:" << fileName;
+                    return false;
+                }
+                continue;
+            }
             const QDateTime mtime = fi.lastModified();
             if (mtime.toMSecsSinceEpoch() > lastStamp) {
                 if (mtime > m_now) {
@@ -640,9 +757,67 @@ private:
 
 void KSycocaPrivate::checkDirectories()
 {
-    if (needsRebuild()) {
-        buildSycoca();
+    QElapsedTimer timer;
+    timer.start();
+    const bool rebuild = needsRebuild();
+    KSycocaStatistics::add(KSycoca::Statistics::DirectoryChecks);
+    KSycocaStatistics::add(KSycoca::Statistics::DirectoryCheckNSecs, timer.nsecsElapsed());
+    if (rebuild) {
+        if (databaseStatus == DatabaseOK && isDaemonRunning(m_databasePath)) {
+            // It noticed the change too, and picking up its database is cheaper than building another one
+            qCDebug(SYCOCA) << "Leaving the rebuild to kbuildsycoca --daemon";
+        } else if (databaseStatus == DatabaseOK && isBackgroundRebuildEnabled()) {
+            startBackgroundRebuild();
+        } else {
+            buildSycoca();
+        }
+    }
+}
+
+bool KSycocaPrivate::watchResources()
+{
+    if (!m_fileWatcher) {
+        return false; // KSycoca::disableAutoRebuild()
+    }
+    if (!m_resourceWatcher) {
+        KSycocaResourceWatcher *watcher = KSycocaResourceWatcher::self();
+        if (!watcher) {
+            return false; // exiting
+        }
+        // Also the mimeapps.list files which don't exist yet, KDirWatch tells when they're created
+        QStringList files = extraFiles.keys() + KMimeAssociations::mimeAppsCandidateFiles();
+        if (!m_databasePath.isEmpty()) {
+            files << m_databasePath << KSycocaDelta::filePath(m_databasePath);
+        }
+        watcher->watch(allResourceDirs.keys(), files);
+        m_resourceWatcher = watcher;
+    }
+    return true;
+}
+
+QStringList KSycocaPrivate::currentExtraFiles()
+{
+    const QString currentDesktop = qEnvironmentVariable("XDG_CURRENT_DESKTOP");
+    const QStringList dirs = KMimeAssociations::mimeAppsDirs();
+    // Creating, removing or replacing a file changes the mtime of its directory
+    QList<qint64> dirStamps;
+    dirStamps.reserve(dirs.size());
+    for (const QString &dir : dirs) {
+        const QFileInfo info(dir);
+        dirStamps.append(info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0);
+    }
+
+    ExtraFilesCache &cache = m_extraFilesCache;
+    if (!cache.valid || cache.currentDesktop != currentDesktop || cache.dirs != dirs || cache.dirStamps != dirStamps) {
+        cache.currentDesktop = currentDesktop;
+        cache.dirs = dirs;
+        cache.dirStamps = dirStamps;
+        cache.files = KBuildSycoca::factoryExtraFiles();
+        // ensure files are ordered so the comparison in needsRebuild() works
+        cache.files.sort();
+        cache.valid = true;
     }
+    return cache.files;
 }
 
 bool KSycocaPrivate::needsRebuild()
@@ -651,24 +826,33 @@ bool KSycocaPrivate::needsRebuild()
     if (!timeStamp && databaseStatus != BadVersion) {
         (void)readSycocaHeader();
     }
+    // Nothing changed since the timestamps were last found up to date, no need to check them again
+    if (timeStamp != 0 && resourcesUnchanged()) {
+        return false;
+    }
+    const bool watching = timeStamp != 0 && watchResources();
+    // Read before checking the timestamps, so that changes made meanwhile aren't lost
+    const quint64 changeCount = watching ? m_resourceWatcher->changeCount() : 0;
     // these days timeStamp is really a "bool headerFound", the value itself doesn't matter...
     // KF6: replace it with bool.
     const auto timestampChecker = TimestampChecker();
     bool ret = timeStamp != 0
         && (!timestampChecker.checkDirectoriesTimestamps(allResourceDirs) //
             || !timestampChecker.checkFilesTimestamps(extraFiles));
-    if (ret) {
-        return true;
+    if (!ret) {
+        // to cover cases when extra files were added
+        ret = extraFiles.keys() != currentExtraFiles(); // clazy:exclude=container-anti-pattern
     }
-    auto files = KBuildSycoca::factoryExtraFiles();
-    // ensure files are ordered so next comparison works
-    files.sort();
-    // to cover cases when extra files were added
-    return extraFiles.keys() != files; // clazy:exclude=container-anti-pattern
+    if (watching) {
+        // If outdated, check again next time, until the new database is in use
+        m_resourceChangesSeen = ret ? changeCount - 1 : changeCount;
+    }
+    return ret;
 }
 
 bool KSycocaPrivate::buildSycoca()
 {
+    KSycocaStatistics::add(KSycoca::Statistics::Rebuilds);
     KBuildSycoca builder;
     if (!builder.recreate()) {
         return false; // error
@@ -690,6 +874,47 @@ bool KSycocaPrivate::buildSycoca()
     return true;
 }
 
+void KSycocaPrivate::startBackgroundRebuild()
+{
+    bool expected = false;
+    if (!s_backgroundRebuildRunning.compare_exchange_strong(expected, true)) {
+        return; // the running one will do
+    }
+    qCDebug(SYCOCA) << "Rebuilding ksycoca in the background";
+    KSycocaStatistics::add(KSycoca::Statistics::Rebuilds);
+    // A thread of our own rather than the global pool, so that its KSycoca instance goes away with it
+    QThread *thread = QThread::create([] {
+        {
+            KBuildSycoca builder;
+            builder.recreate();
+        }
+        s_backgroundRebuildRunning = false;
+    });
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    QObject::connect(thread, &QThread::finished, q, [this]() {
+        // Either a new database, or a delta for the current one
+        slotDatabaseChanged();
+        slotDeltaChanged();
+    });
+    thread->start(QThread::LowPriority);
+}
+
+QString KSycocaPrivate::daemonLockFilePath(const QString &databasePath)
+{
+    return databasePath + QLatin1String(".daemon");
+}
+
+bool KSycocaPrivate::isDaemonRunning(const QString &databasePath)
+{
+    QLockFile lock(daemonLockFilePath(databasePath));
+    lock.setStaleLockTime(0); // only stale if its process is gone
+    if (lock.tryLock(0)) {
+        lock.unlock();
+        return false;
+    }
+    return lock.error() == QLockFile::LockFailedError;
+}
+
 QString KSycoca::absoluteFilePath()
 {
     const QStringList paths = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
@@ -728,6 +953,7 @@ void KSycoca::flagError()
     sycoca->d->readError = true;
     if (qAppName() != QLatin1String(KBUILDSYCOCA_EXENAME) && !sycoca->isBuilding()) {
         // Rebuild the damned thing.
+        KSycocaStatistics::add(KSycoca::Statistics::Rebuilds);
         KBuildSycoca builder;
         (void)builder.recreate();
     }
@@ -743,6 +969,13 @@ void KSycoca::disableAutoRebuild()
     ksycocaInstance->sycoca()->d->m_fileWatcher = nullptr;
 }
 
+void KSycoca::setBackgroundRebuildEnabled(bool enabled)
+{
+    // Don't let the configuration override it later on
+    std::call_once(s_backgroundRebuildConfigRead, [] {});
+    s_backgroundRebuild = enabled;
+}
+
 QDataStream *&KSycoca::stream()
 {
     return d->stream();
@@ -756,6 +989,7 @@ void KSycoca::connectNotify(const QMetaMethod &signal)
             d->m_databasePath = d->findDatabase();
         } else if (d->m_fileWatcher) {
             d->m_fileWatcher->addFile(d->m_databasePath);
+            d->m_fileWatcher->addFile(KSycocaDelta::filePath(d->m_databasePath));
         }
     }
 }
@@ -770,8 +1004,12 @@ void KSycoca::clearCaches()
 extern KSERVICE_EXPORT int ksycoca_ms_between_checks;
 KSERVICE_EXPORT int ksycoca_ms_between_checks = 1500;
 
+// How often ensureCacheValid() stats the database even though its generation didn't change
+static const quint32 s_generationChecksBetweenStats = 16;
+
 void KSycoca::ensureCacheValid()
 {
+    KSycocaStatistics::add(KSycoca::Statistics::EnsureCacheValidCalls);
     if (qAppName() == QLatin1String(KBUILDSYCOCA_EXENAME)) {
         return;
     }
@@ -782,14 +1020,31 @@ void KSycoca::ensureCacheValid()
         }
     }
 
-    if (d->m_lastCheck.isValid() && d->m_lastCheck.elapsed() < ksycoca_ms_between_checks) {
+    // kbuildsycoca increments the generation whenever it writes the database or its delta:
+    // if it didn't change, the database on disk is the one we have open
+    const bool haveGeneration = d->m_generation.isOpen();
+    const quint64 generation = d->m_generation.current();
+    const bool generationChanged = haveGeneration && generation != d->m_dbGeneration;
+
+    if (!generationChanged && d->m_lastCheck.isValid() && d->m_lastCheck.elapsed() < ksycoca_ms_between_checks) {
         return;
     }
     d->m_lastCheck.start();
 
+    // The watcher tells us when the database or the files it was built from change
+    if (!generationChanged && d->resourcesUnchanged()) {
+        return;
+    }
+
     // Check if the file on disk was modified since we last checked it.
-    QFileInfo info(d->m_databasePath);
-    if (info.lastModified() == d->m_dbLastModified) {
+    // Now and then even if the generation says it wasn't, in case something else than kbuildsycoca replaced it
+    const bool trustGeneration = haveGeneration && !generationChanged && ++d->m_generationChecks % s_generationChecksBetweenStats != 0;
+    if (trustGeneration || QFileInfo(d->m_databasePath).lastModified() == d->m_dbLastModified) {
+        if (!haveGeneration || generationChanged) {
+            // kbuildsycoca may have written a delta instead of a new database
+            d->reloadDeltaIfChanged();
+            d->m_dbGeneration = generation;
+        }
         // Check if the watched directories were modified, then the cache needs a rebuild.
         d->checkDirectories();
         return;
@@ -14,12 +14,14 @@
 #include <ksycocatype.h>
 
 #include <QObject>
+#include <QSharedDataPointer>
 #include <QStringList>
 
 class QDataStream;
 class KSycocaFactory;
 class KSycocaFactoryList;
 class KSycocaPrivate;
+class KSycocaStatisticsPrivate;
 
 /*!
  * \macro KBUILDSYCOCA_EXENAME
@@ -124,6 +126,133 @@ public:
      */
     static void disableAutoRebuild();
 
+    /*!
+     * When \a enabled, an outdated cache is rebuilt in a separate thread instead of
+     * blocking the caller, which meanwhile keeps getting results from the current cache.
+     * databaseChanged() is emitted once the new cache is in use.
+     *
+     * The cache is still built synchronously when there's none at all yet.
+     *
+     * This applies to the whole process. Unless this is called, the backgroundRebuild key
+     * of the [KSycoca] group in kdeglobals is used, which is read once per process.
+     *
+     * \since 6.29
+     */
+    static void setBackgroundRebuildEnabled(bool enabled);
+
+    /*!
+     * \class KSycoca::Statistics
+     * \inmodule KService
+     *
+     * \brief Counters of the work done by KSycoca in this process, see statistics().
+     *
+     * \since 6.29
+     */
+    class KSERVICE_EXPORT Statistics
+    {
+    public:
+        /*!
+         * The hash tables of the database
+         *
+         * \value ServicesByName
+         * \value ServicesByDesktopName
+         * \value ServicesByDesktopPath
+         * \value ServicesByMenuId
+         * \value ServiceGroupsByPath
+         * \value ServiceGroupsByBaseName
+         * \value MimeTypesByName
+         */
+        enum Dict {
+            ServicesByName,
+            ServicesByDesktopName,
+            ServicesByDesktopPath,
+            ServicesByMenuId,
+            ServiceGroupsByPath,
+            ServiceGroupsByBaseName,
+            MimeTypesByName,
+        };
+
+        /*!
+         * The types of the entries read from the database
+         *
+         * \value ServiceEntry
+         * \value ServiceGroupEntry
+         * \value MimeTypeEntry
+         */
+        enum EntryType {
+            ServiceEntry,
+            ServiceGroupEntry,
+            MimeTypeEntry,
+        };
+
+        /*!
+         * \value DecodedBytes Bytes read from the database to decode entries
+         * \value DuplicateListSteps Entries skipped in hash table duplicate lists
+         * \value EnsureCacheValidCalls Calls to ensureCacheValid(), including those made by KService and friends
+         * \value DirectoryChecks Checks whether the files the database was built from changed
+         * \value DirectoryCheckNSecs Total duration of these checks, in nanoseconds
+         * \value Rebuilds Rebuilds of the database started by this process, in the foreground or in the background
+         * \value Reopens Times the database was opened again, after it changed or caches were cleared
+         */
+        enum Counter {
+            DecodedBytes,
+            DuplicateListSteps,
+            EnsureCacheValidCalls,
+            DirectoryChecks,
+            DirectoryCheckNSecs,
+            Rebuilds,
+            Reopens,
+        };
+
+        /*!
+         * Creates statistics where everything is 0
+         */
+        Statistics();
+        Statistics(const Statistics &other);
+        Statistics &operator=(const Statistics &other);
+        ~Statistics();
+
+        /*!
+         * Returns the number of lookups in \a dict
+         */
+        quint64 probes(Dict dict) const;
+
+        /*!
+         * Returns the number of lookups in \a dict which found a matching entry
+         */
+        quint64 hits(Dict dict) const;
+
+        /*!
+         * Returns the number of lookups in \a dict which didn't find a matching entry
+         */
+        quint64 misses(Dict dict) const;
+
+        /*!
+         * Returns the number of entries of type \a type read from the database
+         */
+        quint64 decodedEntries(EntryType type) const;
+
+        /*!
+         * Returns the value of \a counter
+         */
+        quint64 value(Counter counter) const;
+
+    private:
+        friend class KSycocaStatisticsPrivate;
+        QSharedDataPointer<KSycocaStatisticsPrivate> d;
+    };
+
+    /*!
+     * Returns the counters of the work done by KSycoca in this process so far, in all threads.
+     *
+     * The counters are always enabled, and cheap enough not to matter.
+     * Setting the environment variable KSYCOCA_STATISTICS to 1 prints them when the process exits,
+     * any other value is the path of a file to append them to.
+     *
+     * \since 6.29
+     */
+    static Statistics statistics();
+
     /*!
      * A read error occurs.
      * \internal
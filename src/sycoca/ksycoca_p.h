@@ -11,7 +11,10 @@
 #ifndef KSYCOCA_P_H
 #define KSYCOCA_P_H
 
+#include "ksycocadelta_p.h"
 #include "ksycocafactory_p.h"
+#include "ksycocageneration_p.h"
+#include "ksycocaresourcewatcher_p.h"
 #include <KDirWatch>
 #include <QDateTime>
 #include <QElapsedTimer>
@@ -68,6 +71,7 @@ public:
     void closeDatabase();
     void setStrategyFromString(const QString &strategy);
     bool tryMmap();
+    bool tryMemFd();
 
     /*!
      * Check if the on-disk cache needs to be rebuilt, and do it then.
@@ -79,19 +83,77 @@ public:
      */
     bool needsRebuild();
 
+    /*!
+     * Watch the database and its resource directories and extra files with KSycocaResourceWatcher,
+     * so that ensureCacheValid() and needsRebuild() don't have to check the timestamps until one of them changes.
+     * Returns false if they aren't watched, see KSycoca::disableAutoRebuild().
+     */
+    bool watchResources();
+
+    /*!
+     * Returns true if nothing the database was built from changed since it was last found up to date.
+     * This is the fast path of ensureCacheValid(), a single atomic load.
+     */
+    bool resourcesUnchanged() const
+    {
+        return m_resourceWatcher && m_resourceWatcher->changeCount() == m_resourceChangesSeen;
+    }
+
+    /*!
+     * Returns KBuildSycoca::factoryExtraFiles(), sorted. The candidate files are only resolved again
+     * when XDG_CURRENT_DESKTOP, the directories they're looked up in, or the contents of these directories changed.
+     */
+    QStringList currentExtraFiles();
+
     /*!
      * Recreate the cache and reopen the database
      */
     bool buildSycoca();
 
+    /*!
+     * Recreate the cache in a separate thread, while we keep using the current database.
+     * Once done, the new database is picked up as if another process had written it.
+     */
+    void startBackgroundRebuild();
+
+    /*!
+     * Returns the path of the lock file which kbuildsycoca --daemon holds while it watches
+     * the files the database at \a databasePath is built from
+     */
+    static QString daemonLockFilePath(const QString &databasePath);
+
+    /*!
+     * Returns true if kbuildsycoca --daemon is running for the database at \a databasePath,
+     * in which case it rebuilds the database shortly after any change, and applications don't have to
+     */
+    static bool isDaemonRunning(const QString &databasePath);
+
     KSycocaHeader readSycocaHeader();
 
     KSycocaAbstractDevice *device();
     QDataStream *&stream();
 
+    /*!
+     * Returns the memory-mapped database without copying it, or an empty array
+     * when another strategy than mmap is in use.
+     * The data is only valid until closeDatabase() is called.
+     */
+    QByteArray mappedData() const;
+
     QString findDatabase();
     void slotDatabaseChanged();
 
+    /*!
+     * Loads the delta of the open database, see KSycocaDelta
+     */
+    void loadDelta();
+
+    /*!
+     * Reloads the delta if its file changed since it was loaded, and returns true then
+     */
+    bool reloadDeltaIfChanged();
+    void slotDeltaChanged();
+
     KMimeTypeFactory *mimeTypeFactory();
     KServiceFactory *serviceFactory();
     KServiceGroupFactory *serviceGroupFactory();
@@ -104,12 +166,15 @@ public:
     bool readError;
 
     qint64 timeStamp; // in ms since epoch
-    enum { StrategyMmap, StrategyMemFile, StrategyFile } m_sycocaStrategy;
+    enum { StrategyMmap, StrategyMemFile, StrategyFile, StrategyMemFd } m_sycocaStrategy;
     QString m_databasePath;
     QString language;
     quint32 updateSig;
-    QMap<QString, qint64> allResourceDirs; // path, modification time in "ms since epoch"
-    QMap<QString, qint64> extraFiles; // path, modification time in "ms since epoch"
+    QMap<QString, qint64> allResourceDirs; // path, modification time in "ms since epoch", or KSycocaContentHash stamp
+    QMap<QString, qint64> extraFiles; // path, modification time in "ms since epoch", or KSycocaContentHash stamp
+
+    KSycocaDelta m_delta;
+    bool m_applyDelta = true; // false while kbuildsycoca reads the entries of the database it updates
 
     void addFactory(KSycocaFactory *factory)
     {
@@ -122,6 +187,10 @@ public:
 
     QElapsedTimer m_lastCheck;
     QDateTime m_dbLastModified;
+    KSycocaGeneration m_generation; // of the database at m_databasePath
+    quint64 m_dbGeneration = 0; // when the database or its delta was last (re)loaded
+    quint32 m_generationChecks = 0; // see ensureCacheValid()
+    bool m_openedBefore = false; // to count reopens in KSycoca::statistics()
 
     // Using KDirWatch because it will reliably tell us every time ksycoca is recreated.
     // QFileSystemWatcher's inotify implementation easily gets confused between "removed" and "changed",
@@ -130,6 +199,16 @@ public:
     // NOTE: this may be nullptr when file watching is disabled on the current thread
     std::unique_ptr<KDirWatch> m_fileWatcher;
     bool m_haveListeners;
+    KSycocaResourceWatcher *m_resourceWatcher = nullptr; // once the resources from the current header are watched
+    quint64 m_resourceChangesSeen = 0; // its changeCount() when the database was last found up to date
+
+    struct ExtraFilesCache {
+        QString currentDesktop;
+        QStringList dirs;
+        QList<qint64> dirStamps; // mtime in ms since epoch, 0 if missing
+        QStringList files;
+        bool valid = false;
+    } m_extraFilesCache;
 
     KSycoca *q;
 
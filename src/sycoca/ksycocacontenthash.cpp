@@ -0,0 +1,220 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocacontenthash_p.h"
+#include "sycocadebug.h"
+
+#include <KConfigGroup>
+#include <KSharedConfig>
+#include <ksycoca.h>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <qplatformdefs.h>
+
+#include <functional>
+
+KSycocaContentHash::KSycocaContentHash()
+{
+    KConfigGroup config(KSharedConfig::openConfig(), QStringLiteral("KSycoca"));
+    m_allFiles = config.readEntry("changeDetection") == QLatin1String("content");
+}
+
+QString KSycocaContentHash::filePath(const QString &databasePath)
+{
+    return databasePath + QLatin1String(".contenthash");
+}
+
+void KSycocaContentHash::load(const QString &databasePath)
+{
+    m_cache.clear();
+    m_modified = false;
+
+    QFile file(filePath(databasePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream str(&file);
+    str.setVersion(QDataStream::Qt_5_3);
+    qint32 version;
+    qint32 count;
+    str >> version >> count;
+    if (version != KSycoca::version() || count < 0) {
+        qCDebug(SYCOCA) << "Ignoring" << file.fileName() << "written by another version";
+        return;
+    }
+    m_cache.reserve(count);
+    for (qint32 i = 0; i < count && str.status() == QDataStream::Ok; ++i) {
+        QString path;
+        CacheEntry entry;
+        str >> path >> entry.inode >> entry.size >> entry.mtime >> entry.ctime >> entry.hash;
+        m_cache.insert(path, entry);
+    }
+    if (str.status() != QDataStream::Ok) {
+        qCWarning(SYCOCA) << "Couldn't read" << file.fileName();
+        m_cache.clear();
+    }
+}
+
+bool KSycocaContentHash::save(const QString &databasePath)
+{
+    const qsizetype oldCount = m_cache.size();
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        it = it->used ? std::next(it) : m_cache.erase(it);
+    }
+    if (!m_modified && m_cache.size() == oldCount) {
+        return true;
+    }
+    if (m_cache.isEmpty()) {
+        QFile::remove(filePath(databasePath));
+        return true;
+    }
+
+    QSaveFile file(filePath(databasePath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(SYCOCA) << "ERROR creating" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+    QDataStream str(&file);
+    str.setVersion(QDataStream::Qt_5_3);
+    str << qint32(KSycoca::version()) << qint32(m_cache.size());
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        const CacheEntry &entry = it.value();
+        str << it.key() << entry.inode << entry.size << entry.mtime << entry.ctime << entry.hash;
+    }
+    if (str.status() != QDataStream::Ok || !file.commit()) {
+        qCWarning(SYCOCA) << "ERROR writing" << file.fileName() << file.errorString();
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
+
+bool KSycocaContentHash::readIdentity(const QString &path, CacheEntry *entry)
+{
+#ifdef Q_OS_UNIX
+    QT_STATBUF st;
+    if (QT_STAT(QFile::encodeName(path).constData(), &st) == 0) {
+        entry->inode = st.st_ino;
+        entry->size = st.st_size;
+#ifdef Q_OS_LINUX
+        entry->mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        entry->ctime = qint64(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#else
+        entry->mtime = qint64(st.st_mtime) * 1000000000;
+        entry->ctime = qint64(st.st_ctime) * 1000000000;
+#endif
+        return true;
+    }
+#endif
+    // Other platforms, and resources
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return false;
+    }
+    entry->inode = 0;
+    entry->size = info.size();
+    entry->mtime = info.lastModified().toMSecsSinceEpoch() * 1000000;
+    entry->ctime = info.fileTime(QFile::FileMetadataChangeTime).toMSecsSinceEpoch() * 1000000;
+    return true;
+}
+
+quint32 KSycocaContentHash::fileHash(const QString &path)
+{
+    CacheEntry identity;
+    if (!readIdentity(path, &identity)) {
+        return 0;
+    }
+    return fileHash(path, identity);
+}
+
+quint32 KSycocaContentHash::fileHash(const QString &path, quint64 inode, qint64 size, qint64 mtime, qint64 ctime)
+{
+    CacheEntry identity;
+    identity.inode = inode;
+    identity.size = size;
+    identity.mtime = mtime;
+    identity.ctime = ctime;
+    return fileHash(path, identity);
+}
+
+quint32 KSycocaContentHash::fileHash(const QString &path, CacheEntry identity)
+{
+    auto it = m_cache.find(path);
+    if (it != m_cache.end() && it->inode == identity.inode && it->size == identity.size && it->mtime == identity.mtime && it->ctime == identity.ctime) {
+        it->used = true;
+        return it->hash;
+    }
+
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+        return 0;
+    }
+    identity.hash = qFromLittleEndian<quint32>(hash.result().constData());
+    if (identity.hash == 0) {
+        identity.hash = 1; // 0 means "no file"
+    }
+    identity.used = true;
+    m_cache.insert(path, identity);
+    m_modified = true;
+    return identity.hash;
+}
+
+// The identity of an entry, without its change time: creating a hard link to it changes it,
+// which is what ostree does for unchanged files when deploying a new version of the system.
+static void addIdentity(QCryptographicHash &hash, const QString &path, bool exists, quint64 inode, qint64 size, qint64 mtime)
+{
+    hash.addData(QFile::encodeName(path));
+    const qint64 values[] = {exists, qint64(inode), size, mtime};
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(values), sizeof(values)));
+}
+
+static qint64 toStamp(const QCryptographicHash &hash)
+{
+    // Negative, see isContentStamp
+    return -1 - qint64(qFromLittleEndian<quint64>(hash.result().constData()) & 0x3fffffffffffffffULL);
+}
+
+qint64 KSycocaContentHash::directoryStamp(const QString &dir)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    // Recurse only for services and menus, see visitResourceDirectory
+    const bool recursive = !dir.contains(QLatin1String("/applications"));
+    std::function<void(const QString &)> addDirectory = [&](const QString &path) {
+        // Creating, removing or renaming an entry changes the change time of its directory,
+        // and a new deployment (ostree) has new directories
+        CacheEntry identity;
+        const bool exists = readIdentity(path, &identity);
+        hash.addData(QFile::encodeName(path));
+        const qint64 values[] = {exists, qint64(identity.inode), identity.ctime};
+        hash.addData(QByteArrayView(reinterpret_cast<const char *>(values), sizeof(values)));
+        if (!exists || !recursive) {
+            return;
+        }
+        const QStringList subdirs = QDir(path).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks, QDir::Name);
+        for (const QString &subdir : subdirs) {
+            addDirectory(path + QLatin1Char('/') + subdir);
+        }
+    };
+    addDirectory(dir);
+    return toStamp(hash);
+}
+
+qint64 KSycocaContentHash::fileStamp(const QString &path)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    CacheEntry identity;
+    const bool exists = readIdentity(path, &identity);
+    addIdentity(hash, path, exists, identity.inode, identity.size, identity.mtime);
+    return toStamp(hash);
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCACONTENTHASH_P_H
+#define KSYCOCACONTENTHASH_P_H
+
+#include <kservice_export.h>
+
+#include <QHash>
+#include <QString>
+
+/*!
+ * \internal
+ * Change detection based on contents rather than modification times, which mean nothing
+ * on ostree based systems (e.g. Fedora Kinoite): all files in /usr have a modification time of 0 there.
+ * It is used for such files and directories, or for all of them when the changeDetection key
+ * of the [KSycoca] group in kdeglobals is set to "content".
+ *
+ * Files are identified by a hash of their contents, cached next to the database by inode, size
+ * and change time, so that kbuildsycoca only reads the files which were replaced.
+ *
+ * Directories are identified by a stamp of their own inodes and change times, and extra files by a stamp
+ * of their inode, size and modification time, which is stored in the database instead of a modification time.
+ * Readers compute the same stamps, without stat()ing or reading the files: applications dirs take a single stat(),
+ * the services and menus dirs are listed to find their subdirs, which are stat()ed.
+ * These stamps are negative, so that the readers know to compare them for equality.
+ * Only kbuildsycoca hashes the contents of the files, to find out which ones it has to parse again.
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KSycocaContentHash
+{
+public:
+    /*!
+     * Reads the changeDetection key of the [KSycoca] group in kdeglobals
+     */
+    KSycocaContentHash();
+
+    /*!
+     * Returns true if the contents are compared for all files,
+     * rather than only for those with a modification time of 0
+     */
+    bool isEnabledForAllFiles() const
+    {
+        return m_allFiles;
+    }
+
+    void setEnabledForAllFiles(bool b)
+    {
+        m_allFiles = b;
+    }
+
+    /*!
+     * Returns the path of the cache file for the database at \a databasePath
+     */
+    static QString filePath(const QString &databasePath);
+
+    /*!
+     * Loads the hashes computed when the database at \a databasePath was built
+     */
+    void load(const QString &databasePath);
+
+    /*!
+     * Writes the hashes used since load(), if any changed, dropping those of files which are gone
+     */
+    bool save(const QString &databasePath);
+
+    /*!
+     * Returns a hash of the contents of the file at \a path, which is never 0,
+     * or 0 if the file can't be read
+     */
+    quint32 fileHash(const QString &path);
+
+    /*!
+     * Same as fileHash(const QString &), for a file already stat()ed, e.g. by KSycocaDirectoryScan.
+     * \a mtime and \a ctime are in ns since epoch.
+     */
+    quint32 fileHash(const QString &path, quint64 inode, qint64 size, qint64 mtime, qint64 ctime);
+
+    /*!
+     * Returns a stamp of the inode and change time of \a dir (and of its subdirs, except for applications dirs,
+     * same as KSycocaUtilsPrivate::visitResourceDirectory, which lists them), which changes when files are added,
+     * removed or replaced.
+     * Files modified in place aren't noticed, which doesn't happen in the read-only trees of ostree based systems.
+     */
+    static qint64 directoryStamp(const QString &dir);
+
+    /*!
+     * Returns a stamp of the file at \a path, which changes when it is replaced
+     */
+    static qint64 fileStamp(const QString &path);
+
+    /*!
+     * Returns true if \a stamp was returned by directoryStamp() or fileStamp(),
+     * rather than being a modification time
+     */
+    static bool isContentStamp(qint64 stamp)
+    {
+        return stamp < 0;
+    }
+
+private:
+    struct CacheEntry {
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 mtime = 0; // ns since epoch
+        qint64 ctime = 0; // ns since epoch
+        quint32 hash = 0;
+        bool used = false; // by the current build
+    };
+    static bool readIdentity(const QString &path, CacheEntry *entry);
+    quint32 fileHash(const QString &path, CacheEntry identity);
+
+    QHash<QString, CacheEntry> m_cache; // absolute path
+    bool m_allFiles = false;
+    bool m_modified = false;
+};
+
+#endif
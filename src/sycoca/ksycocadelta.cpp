@@ -0,0 +1,82 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocadelta_p.h"
+#include "sycocadebug.h"
+
+#include <ksycoca.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+QString KSycocaDelta::filePath(const QString &databasePath)
+{
+    return databasePath + QLatin1String(".delta");
+}
+
+bool KSycocaDelta::load(const QString &databasePath, qint64 databaseLastModified)
+{
+    *this = KSycocaDelta();
+
+    QFile file(filePath(databasePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    // Remembered even if the delta is ignored, so that it isn't read again until it changes
+    lastModified = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+
+    QDataStream str(&file);
+    str.setVersion(QDataStream::Qt_5_3);
+    qint32 version;
+    qint64 databaseStamp;
+    str >> version >> databaseStamp;
+    if (version != KSycoca::version() || databaseStamp != databaseLastModified) {
+        qCDebug(SYCOCA) << "Ignoring" << file.fileName() << "which belongs to another database";
+        return false;
+    }
+    QMap<QString, qint64> dirs;
+    QMap<QString, qint64> files;
+    QHash<qint32, QByteArray> records;
+    QList<qint32> addedOffsets;
+    QHash<qint32, QHash<QString, qint32>> dicts;
+    QHash<qint32, QList<Offer>> offers;
+    str >> dirs >> files >> records >> addedOffsets >> dicts >> offers;
+    if (str.status() != QDataStream::Ok) {
+        qCWarning(SYCOCA) << "Couldn't read" << file.fileName();
+        return false;
+    }
+
+    allResourceDirs = dirs;
+    extraFiles = files;
+    m_records = records;
+    m_addedOffsets = addedOffsets;
+    m_dicts = dicts;
+    m_offers = offers;
+    m_loaded = true;
+    qCDebug(SYCOCA) << "Loaded" << m_records.size() << "changed entries," << m_addedOffsets.size() << "of them new, and" << m_offers.size()
+                    << "changed offer lists from" << file.fileName();
+    return true;
+}
+
+bool KSycocaDelta::save(const QString &databasePath, qint64 databaseLastModified) const
+{
+    QSaveFile file(filePath(databasePath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(SYCOCA) << "ERROR creating" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+    QDataStream str(&file);
+    str.setVersion(QDataStream::Qt_5_3);
+    str << qint32(KSycoca::version()) << databaseLastModified << allResourceDirs << extraFiles << m_records << m_addedOffsets << m_dicts << m_offers;
+    if (str.status() != QDataStream::Ok || !file.commit()) {
+        qCWarning(SYCOCA) << "ERROR writing" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCADELTA_P_H
+#define KSYCOCADELTA_P_H
+
+#include <kservice_export.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+
+/*!
+ * \internal
+ * Changes to the services and service groups of a ksycoca database, stored next to it
+ * in a small file, so that kbuildsycoca doesn't have to write a new database for them.
+ *
+ * Every record replaces the one at the same offset in the database. Added services get offsets
+ * past the end of the database, which only exist in the delta. The service dictionary slots
+ * (storage id, desktop name, desktop path, menu id) and the MIME type offer lists which changed
+ * are stored as well, and looked up before those of the database.
+ * It always describes the changes since the database was built, and is rewritten as a whole
+ * by every delta update. A full rebuild removes it (compaction).
+ *
+ * The delta is bound to the database by its modification time, a delta left over from
+ * an older database is ignored.
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KSycocaDelta
+{
+public:
+    /*!
+     * The service dictionaries of the database
+     */
+    enum Dict {
+        StorageIdDict, // KSycocaFactory::sycocaDict()
+        DesktopNameDict,
+        DesktopPathDict,
+        MenuIdDict,
+    };
+
+    /*!
+     * An entry of an offer list: service offset, MIME type inheritance level
+     */
+    using Offer = QPair<qint32, qint32>;
+
+    /*!
+     * Returns the path of the delta file for the database at \a databasePath
+     */
+    static QString filePath(const QString &databasePath);
+
+    /*!
+     * Loads the delta for the database at \a databasePath, last modified at \a databaseLastModified (ms since epoch).
+     * Returns false (and leaves the delta empty) if there's none, or if it belongs to another database.
+     */
+    bool load(const QString &databasePath, qint64 databaseLastModified);
+
+    /*!
+     * Writes the delta for the database at \a databasePath, last modified at \a databaseLastModified (ms since epoch).
+     */
+    bool save(const QString &databasePath, qint64 databaseLastModified) const;
+
+    /*!
+     * Returns the record replacing the one at \a offset in the database,
+     * or nullptr if the entry wasn't changed. An empty record means the entry was removed.
+     */
+    const QByteArray *record(int offset) const
+    {
+        auto it = m_records.constFind(offset);
+        return it != m_records.cend() ? &it.value() : nullptr;
+    }
+
+    void setRecord(int offset, const QByteArray &record)
+    {
+        m_records.insert(offset, record);
+    }
+
+    int recordCount() const
+    {
+        return m_records.size();
+    }
+
+    /*!
+     * Adds the record of a new service, at an offset past the end of the database
+     */
+    void addRecord(int offset, const QByteArray &record)
+    {
+        m_records.insert(offset, record);
+        m_addedOffsets.append(offset);
+    }
+
+    /*!
+     * Returns the offsets of the services added by the delta, in the order they were added
+     */
+    QList<qint32> addedOffsets() const
+    {
+        return m_addedOffsets;
+    }
+
+    /*!
+     * Returns true if the slot of \a key in \a dict was changed, and sets \a offset to
+     * the entry it points to now, or to 0 if the key was removed
+     */
+    bool lookup(Dict dict, const QString &key, int *offset) const
+    {
+        const auto dictIt = m_dicts.constFind(dict);
+        if (dictIt == m_dicts.cend()) {
+            return false;
+        }
+        const auto it = dictIt->constFind(key);
+        if (it == dictIt->cend()) {
+            return false;
+        }
+        *offset = it.value();
+        return true;
+    }
+
+    void setDictSlot(Dict dict, const QString &key, int offset)
+    {
+        m_dicts[dict].insert(key, offset);
+    }
+
+    /*!
+     * Returns the offer list replacing the one of the MIME type at \a mimeTypeOffset in the database,
+     * or nullptr if it didn't change
+     */
+    const QList<Offer> *offers(int mimeTypeOffset) const
+    {
+        auto it = m_offers.constFind(mimeTypeOffset);
+        return it != m_offers.cend() ? &it.value() : nullptr;
+    }
+
+    void setOffers(int mimeTypeOffset, const QList<Offer> &offers)
+    {
+        m_offers.insert(mimeTypeOffset, offers);
+    }
+
+    int offerListCount() const
+    {
+        return m_offers.size();
+    }
+
+    bool isLoaded() const
+    {
+        return m_loaded;
+    }
+
+    QMap<QString, qint64> allResourceDirs; // replaces the directory timestamps from the database header
+    QMap<QString, qint64> extraFiles; // replaces the extra files (mimeapps.list...) from the database header
+    qint64 lastModified = 0; // of the delta file when it was loaded, ms since epoch
+
+private:
+    QHash<qint32, QByteArray> m_records;
+    QList<qint32> m_addedOffsets;
+    QHash<qint32, QHash<QString, qint32>> m_dicts; // Dict -> key -> offset, 0 if removed
+    QHash<qint32, QList<Offer>> m_offers; // MIME type offset -> offer list
+    bool m_loaded = false;
+};
+
+#endif
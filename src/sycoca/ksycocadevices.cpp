@@ -12,6 +12,18 @@
 #include <QFile>
 #include <fcntl.h>
 
+#ifdef Q_OS_UNIX
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_UNIX
+static const qint64 s_pageSize = 4096;
+static const int s_maxCachedPages = 64;
+#endif
+
 KSycocaAbstractDevice::~KSycocaAbstractDevice()
 {
     delete m_stream;
@@ -44,11 +56,101 @@ QIODevice *KSycocaMmapDevice::device()
 }
 #endif
 
+#ifdef Q_OS_UNIX
+KSycocaPagedFile::KSycocaPagedFile(const QString &path)
+    : m_path(path)
+    , m_pages(s_maxCachedPages)
+{
+}
+
+KSycocaPagedFile::~KSycocaPagedFile()
+{
+    close();
+}
+
+bool KSycocaPagedFile::open(OpenMode mode)
+{
+    if (mode != ReadOnly) {
+        setErrorString(QStringLiteral("read-only device"));
+        return false;
+    }
+    m_fd = ::open(QFile::encodeName(m_path).constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    const off_t end = lseek(m_fd, 0, SEEK_END);
+    m_size = end < 0 ? 0 : end;
+    // Unbuffered, since the pages are the buffer
+    return QIODevice::open(ReadOnly | Unbuffered);
+}
+
+void KSycocaPagedFile::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_pages.clear();
+    QIODevice::close();
+}
+
+const QByteArray *KSycocaPagedFile::page(qint64 index)
+{
+    if (const QByteArray *cached = m_pages.object(index)) {
+        return cached;
+    }
+    auto contents = new QByteArray(s_pageSize, Qt::Uninitialized);
+    qint64 filled = 0;
+    while (filled < s_pageSize) {
+        const ssize_t ret = pread(m_fd, contents->data() + filled, s_pageSize - filled, index * s_pageSize + filled);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break; // end of file, or error
+        }
+        filled += ret;
+    }
+    if (filled == 0) {
+        delete contents;
+        return nullptr;
+    }
+    contents->truncate(filled);
+    m_pages.insert(index, contents);
+    return contents;
+}
+
+qint64 KSycocaPagedFile::readData(char *data, qint64 maxSize)
+{
+    qint64 position = pos();
+    qint64 read = 0;
+    while (read < maxSize && position < m_size) {
+        const QByteArray *contents = page(position / s_pageSize);
+        const qint64 offsetInPage = position % s_pageSize;
+        if (!contents || offsetInPage >= contents->size()) {
+            break;
+        }
+        const qint64 count = std::min(maxSize - read, qint64(contents->size()) - offsetInPage);
+        memcpy(data + read, contents->constData() + offsetInPage, count);
+        read += count;
+        position += count;
+    }
+    return read == 0 && maxSize > 0 && position < m_size ? -1 : read;
+}
+
+qint64 KSycocaPagedFile::writeData(const char *, qint64)
+{
+    return -1;
+}
+#endif
+
 KSycocaFileDevice::KSycocaFileDevice(const QString &path)
 {
+#ifdef Q_OS_UNIX
+    m_database = new KSycocaPagedFile(path);
+#else
     m_database = new QFile(path);
-#ifndef Q_OS_WIN
-    (void)fcntl(m_database->handle(), F_SETFD, FD_CLOEXEC);
 #endif
 }
 
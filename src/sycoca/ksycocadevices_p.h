@@ -10,16 +10,18 @@
 
 #include <config-ksycoca.h>
 #include <stdlib.h>
+
+#include <QCache>
+#include <QIODevice>
+#include <QString>
 // TODO: remove mmap() from kdewin32 and use QFile::mmap() when needed
 #ifdef Q_OS_WIN
 #define HAVE_MMAP 0
 #endif
 
-class QString;
 class QDataStream;
 class QBuffer;
 class QFile;
-class QIODevice;
 class KMemFile;
 
 class KSycocaAbstractDevice
@@ -54,7 +56,42 @@ private:
 };
 #endif
 
-// Reading from a QFile
+#ifdef Q_OS_UNIX
+// Reading a file with pread() through a cache of its most recently used pages,
+// so that the small reads after each seek only need a syscall on a cache miss.
+// A QFile would throw its buffer away on every seek.
+class KSycocaPagedFile : public QIODevice
+{
+public:
+    explicit KSycocaPagedFile(const QString &path);
+    ~KSycocaPagedFile() override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override
+    {
+        return false;
+    }
+    qint64 size() const override
+    {
+        return m_size;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    const QByteArray *page(qint64 index);
+
+    QString m_path;
+    int m_fd = -1;
+    qint64 m_size = 0;
+    QCache<qint64, QByteArray> m_pages; // page index, contents
+};
+#endif
+
+// Reading from a file
 class KSycocaFileDevice : public KSycocaAbstractDevice
 {
 public:
@@ -63,7 +100,7 @@ public:
     QIODevice *device() override;
 
 private:
-    QFile *m_database;
+    QIODevice *m_database;
 };
 
 #ifndef QT_NO_SHAREDMEMORY
@@ -5,9 +5,11 @@
     SPDX-License-Identifier: LGPL-2.0-only
 */
 
+#include "kbuildsycocaprofiler_p.h"
 #include "ksycoca.h"
 #include "ksycocadict_p.h"
 #include "ksycocaentry.h"
+#include "ksycocastatistics_p.h"
 #include "sycocadebug.h"
 #include <kservice.h>
 
@@ -151,6 +153,7 @@ int KSycocaDict::find_string(const QString &key) const
         }
         QString dupkey;
         (*d->stream) >> dupkey;
+        KSycocaStatistics::add(KSycoca::Statistics::DuplicateListSteps);
         // qCDebug(SYCOCA) << QString(">> %1 %2").arg(offset,8,16).arg(dupkey);
         if (dupkey == key) {
             return offset;
@@ -187,6 +190,7 @@ QList<int> KSycocaDict::findMultiString(const QString &key) const
         }
         QString dupkey;
         (*d->stream) >> dupkey;
+        KSycocaStatistics::add(KSycoca::Statistics::DuplicateListSteps);
         // qCDebug(SYCOCA) << QString(">> %1 %2").arg(offset,8,16).arg(dupkey);
         if (dupkey == key) {
             offsetList.append(offset);
@@ -312,6 +316,7 @@ static void addDiversity(std::vector<std::unique_ptr<string_entry>> *stringlist,
 
 void KSycocaDict::save(QDataStream &str)
 {
+    KBuildSycocaProfiler::Span span("KSycocaDict::save", QStringLiteral("%1 keys").arg(count()));
     if (count() == 0) {
         d->hashTableSize = 0;
         d->hashList.clear();
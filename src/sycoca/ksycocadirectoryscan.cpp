@@ -0,0 +1,246 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocadirectoryscan_p.h"
+#include "sycocadebug.h"
+
+#include <QDir>
+#include <QFile>
+#include <QThreadPool>
+
+#include <functional>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using EntryHash = QHash<QString, KSycocaDirectoryScan::Entry>;
+
+#ifdef Q_OS_UNIX
+namespace
+{
+qint64 modificationTime(const struct stat &st)
+{
+#if defined(Q_OS_LINUX)
+    return qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#elif defined(Q_OS_DARWIN)
+    return qint64(st.st_mtimespec.tv_sec) * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+    return qint64(st.st_mtime) * 1000;
+#endif
+}
+
+// Same as KSycocaContentHash::readIdentity(), so that the cache of hashes recognizes the files
+void setIdentity(KSycocaDirectoryScan::Entry *entry, const struct stat &st)
+{
+    entry->inode = st.st_ino;
+    entry->size = st.st_size;
+#if defined(Q_OS_LINUX)
+    entry->mtimeNSecs = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    entry->ctimeNSecs = qint64(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#else
+    entry->mtimeNSecs = qint64(st.st_mtime) * 1000000000;
+    entry->ctimeNSecs = qint64(st.st_ctime) * 1000000000;
+#endif
+}
+
+// readable comes from access(), which (unlike the mode bits) takes ACLs and capabilities into account, like QFileInfo::isReadable()
+KSycocaDirectoryScan::Entry makeEntry(const struct stat &st, bool isSymLink, bool readable)
+{
+    KSycocaDirectoryScan::Entry entry;
+    entry.mtime = modificationTime(st);
+    setIdentity(&entry, st);
+    entry.isDir = S_ISDIR(st.st_mode);
+    entry.isFile = S_ISREG(st.st_mode);
+    entry.isSymLink = isSymLink;
+    entry.readable = readable;
+    return entry;
+}
+
+struct RootScanner {
+    EntryHash &entries;
+    // The directories being scanned, from the root down to the current one: a symlink to one of them is a loop.
+    // Directories reached through several symlinks are scanned under each path, like QDirIterator lists them.
+    QList<QPair<dev_t, ino_t>> ancestors;
+
+    // Takes ownership of dirFd
+    void scanDirectory(int dirFd, const QString &path)
+    {
+        DIR *dir = fdopendir(dirFd);
+        if (!dir) {
+            ::close(dirFd);
+            return;
+        }
+        QStringList children;
+        QStringList subDirs;
+        while (const dirent *ent = readdir(dir)) {
+            const char *name = ent->d_name;
+            if (name[0] == '.') {
+                continue; // ".", ".." and hidden files, which QDirIterator skips by default
+            }
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, 0) != 0) {
+                continue; // broken symlink, or deleted meanwhile
+            }
+            if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) {
+                continue; // sockets, fifos... QDirIterator skips them by default too
+            }
+            bool isSymLink = false;
+#ifdef _DIRENT_HAVE_D_TYPE
+            if (ent->d_type != DT_UNKNOWN) {
+                isSymLink = ent->d_type == DT_LNK;
+            } else
+#endif
+            {
+                struct stat lst;
+                isSymLink = fstatat(dirfd(dir), name, &lst, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(lst.st_mode);
+            }
+
+            const QString fileName = QFile::decodeName(name);
+            children.append(fileName);
+            const bool readable = faccessat(dirfd(dir), name, R_OK, 0) == 0;
+            entries.insert(path + QLatin1Char('/') + fileName, makeEntry(st, isSymLink, readable));
+            if (S_ISDIR(st.st_mode) && !ancestors.contains(qMakePair(st.st_dev, st.st_ino))) {
+                subDirs.append(fileName);
+            }
+        }
+        entries[path].children = children;
+
+        for (const QString &subDir : std::as_const(subDirs)) {
+            const int fd = openat(dirfd(dir), QFile::encodeName(subDir).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                ::close(fd);
+                continue;
+            }
+            ancestors.append(qMakePair(st.st_dev, st.st_ino));
+            scanDirectory(fd, path + QLatin1Char('/') + subDir);
+            ancestors.removeLast();
+        }
+        closedir(dir);
+    }
+
+    void scanRoot(const QString &root)
+    {
+        const QByteArray encodedRoot = QFile::encodeName(root);
+        struct stat st;
+        if (stat(encodedRoot.constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            return;
+        }
+        struct stat lst;
+        const bool isSymLink = lstat(encodedRoot.constData(), &lst) == 0 && S_ISLNK(lst.st_mode);
+        entries.insert(root, makeEntry(st, isSymLink, access(encodedRoot.constData(), R_OK) == 0));
+        ancestors.append(qMakePair(st.st_dev, st.st_ino));
+
+        const int fd = open(encodedRoot.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            scanDirectory(fd, root);
+        }
+    }
+};
+}
+#endif
+
+void KSycocaDirectoryScan::scan(const QStringList &roots)
+{
+#ifdef Q_OS_UNIX
+    QList<EntryHash> results(roots.size());
+    EntryHash *out = results.data();
+
+    // One task per root: the roots are typically on different disks (home, /usr, flatpak exports...)
+    QThreadPool pool;
+    for (qsizetype i = 0; i < roots.size(); ++i) {
+        const QString root = clean(roots.at(i));
+        if (m_roots.contains(root)) {
+            continue;
+        }
+        m_roots.append(root);
+        pool.start([root, out, i] {
+            RootScanner scanner{out[i], {}};
+            scanner.scanRoot(root);
+        });
+    }
+    pool.waitForDone();
+
+    for (const EntryHash &entries : std::as_const(results)) {
+        m_entries.insert(entries);
+    }
+    qCDebug(SYCOCA) << "Scanned" << m_entries.size() << "entries under" << m_roots;
+#else
+    Q_UNUSED(roots)
+#endif
+}
+
+bool KSycocaDirectoryScan::covers(const QString &path) const
+{
+    const QString cleanPath = clean(path);
+    for (const QString &root : m_roots) {
+        if (cleanPath == root || (cleanPath.startsWith(root) && cleanPath.at(root.size()) == QLatin1Char('/'))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const KSycocaDirectoryScan::Entry *KSycocaDirectoryScan::entry(const QString &path) const
+{
+    auto it = m_entries.constFind(clean(path));
+    return it != m_entries.cend() ? &it.value() : nullptr;
+}
+
+QStringList KSycocaDirectoryScan::relativePaths(const QString &dir) const
+{
+    QStringList result;
+    std::function<void(const QString &, const QString &)> collect = [&](const QString &path, const QString &relPath) {
+        const Entry *dirEntry = entry(path);
+        if (!dirEntry) {
+            return;
+        }
+        for (const QString &name : dirEntry->children) {
+            const QString childPath = path + QLatin1Char('/') + name;
+            const QString childRelPath = relPath.isEmpty() ? name : relPath + QLatin1Char('/') + name;
+            result.append(childRelPath);
+            const Entry *child = entry(childPath);
+            if (child && child->isDir) {
+                collect(childPath, childRelPath);
+            }
+        }
+    };
+    collect(clean(dir), QString());
+    return result;
+}
+
+qint64 KSycocaDirectoryScan::directoryStamp(const QString &dir, bool recursive) const
+{
+    const Entry *dirEntry = entry(dir);
+    if (!dirEntry) {
+        return 0;
+    }
+    qint64 stamp = dirEntry->mtime;
+    if (recursive) {
+        const QString path = clean(dir);
+        for (const QString &name : dirEntry->children) {
+            const QString childPath = path + QLatin1Char('/') + name;
+            const Entry *child = entry(childPath);
+            if (child && child->isDir && !child->isSymLink) {
+                stamp = std::max(stamp, directoryStamp(childPath, true));
+            }
+        }
+    }
+    return stamp;
+}
+
+QString KSycocaDirectoryScan::clean(const QString &path)
+{
+    return QDir::cleanPath(path);
+}
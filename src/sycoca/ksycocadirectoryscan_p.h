@@ -0,0 +1,100 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCADIRECTORYSCAN_P_H
+#define KSYCOCADIRECTORYSCAN_P_H
+
+#include <kservice_export.h>
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+/*!
+ * \internal
+ * Scans directory trees once, so that kbuildsycoca doesn't list and stat the same files
+ * for the directory timestamps, the resource file lists, the file hashes and the menu code.
+ *
+ * Roots are scanned in parallel, one task per root. Symlinked directories are followed
+ * (except for links to a parent, which would loop), but remembered as symlinks, since some consumers
+ * don't recurse into them.
+ * Hidden files are skipped, like QDirIterator does by default.
+ *
+ * On platforms without a native implementation nothing is scanned,
+ * and contains() returns false so that callers use their QFileInfo-based code path.
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KSycocaDirectoryScan
+{
+public:
+    struct Entry {
+        qint64 mtime = 0; // ms since epoch, of the symlink target
+        // What KSycocaContentHash keys its cache on, of the symlink target
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 mtimeNSecs = 0; // ns since epoch
+        qint64 ctimeNSecs = 0; // ns since epoch
+        bool isDir = false; // of the symlink target
+        bool isFile = false; // of the symlink target
+        bool isSymLink = false;
+        bool readable = false;
+        QStringList children; // file names, for directories
+    };
+
+    /*!
+     * Scans \a roots recursively. Roots which don't exist are remembered as scanned but empty.
+     */
+    void scan(const QStringList &roots);
+
+    /*!
+     * Returns true if \a path is inside (or is) one of the scanned roots,
+     * i.e. whether the table can answer for it, even if only to say that it doesn't exist.
+     */
+    bool covers(const QString &path) const;
+
+    /*!
+     * Returns true if \a path was found by the scan
+     */
+    bool contains(const QString &path) const
+    {
+        return m_entries.contains(clean(path));
+    }
+
+    /*!
+     * Returns the entry for \a path, or nullptr if it wasn't found by the scan
+     */
+    const Entry *entry(const QString &path) const;
+
+    /*!
+     * Returns all paths below \a dir, relative to it, recursing into symlinked directories too
+     * (like QDirIterator with Subdirectories | FollowSymlinks)
+     */
+    QStringList relativePaths(const QString &dir) const;
+
+    /*!
+     * Returns the latest modification time of \a dir and, when \a recursive,
+     * of all the directories below it which are not symlinks (see KSycocaUtilsPrivate::visitResourceDirectory)
+     */
+    qint64 directoryStamp(const QString &dir, bool recursive) const;
+
+    /*!
+     * Returns the path of \a name in \a dir, the way all the consumers of the scan must build it
+     */
+    static QString childPath(const QString &dir, const QString &name)
+    {
+        return clean(dir) + QLatin1Char('/') + name;
+    }
+
+private:
+    static QString clean(const QString &path);
+
+    QHash<QString, Entry> m_entries;
+    QStringList m_roots;
+};
+
+#endif
@@ -6,6 +6,7 @@
 */
 
 #include "ksycoca.h"
+#include "ksycoca_p.h"
 #include "ksycocadict_p.h"
 #include "ksycocaentry.h"
 #include "ksycocaentry_p.h"
@@ -13,10 +14,18 @@
 #include "ksycocatype.h"
 #include "sycocadebug.h"
 
+#include <QBuffer>
 #include <QDebug>
 #include <QHash>
 #include <QIODevice>
+#include <QSemaphore>
 #include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+// Below this many entries per chunk, the cost of handing work to another thread outweighs decoding
+static const int s_minEntriesPerChunk = 64;
 
 class KSycocaFactoryPrivate
 {
@@ -187,39 +196,171 @@ void KSycocaFactory::removeEntry(const QString &entryName)
     d->m_sycocaDict->remove(entryName); // O(N)
 }
 
-KSycocaEntry::List KSycocaFactory::allEntries() const
+QList<qint32> KSycocaFactory::entryOffsets() const
 {
-    KSycocaEntry::List list;
+    QList<qint32> offsetList;
 
     // Assume we're NOT building a database
 
     QDataStream *str = stream();
     if (!str) {
-        return list;
+        return offsetList;
     }
     str->device()->seek(d->m_endEntryOffset);
     qint32 entryCount;
     (*str) >> entryCount;
 
-    if (entryCount < 0 || entryCount > 8192) { // mind that new accepts a size_t (unsigned) but we are dealing with an int here
+    if (entryCount < 0 || entryCount > 8192) {
         qCWarning(SYCOCA) << QThread::currentThread() << "error detected in factory" << this << entryCount;
         KSycoca::flagError();
-        return list;
+        return offsetList;
+    }
+
+    // The whole linear index is read up front because createEntry() modifies the stream position
+    offsetList.resize(entryCount);
+    for (qint32 &offset : offsetList) {
+        (*str) >> offset;
+    }
+    return offsetList;
+}
+
+KSycocaEntry *KSycocaFactory::decodeEntry(QDataStream &, int) const
+{
+    return nullptr;
+}
+
+QList<KSycocaEntry *> KSycocaFactory::decodeEntries(const QList<qint32> &offsets) const
+{
+    QList<KSycocaEntry *> entries;
+    entries.reserve(offsets.size());
+
+    auto decodeSequentially = [&](qsizetype from) {
+        for (qsizetype i = from; i < offsets.size(); ++i) {
+            KSycocaEntry *newEntry = createEntry(offsets.at(i));
+            if (newEntry) {
+                entries.append(newEntry);
+            }
+        }
+    };
+
+    // Every chunk gets its own QBuffer over the mapping, so that no stream position is shared.
+    // QBuffer::setData() doesn't copy the raw data, and reading never detaches it.
+    const QByteArray data = m_sycoca->d->mappedData();
+    auto decodeChunk = [this, &data, &offsets](qsizetype begin, qsizetype end, KSycocaEntry **out) {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        QDataStream str(&buffer);
+        str.setVersion(QDataStream::Qt_5_3);
+        for (qsizetype i = begin; i < end; ++i) {
+            const qint32 offset = offsets.at(i);
+            out[i] = buffer.seek(offset) ? decodeEntry(str, offset) : nullptr;
+        }
+    };
+
+    const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+    if (data.isEmpty() || maxThreads < 2 || offsets.size() < 2 * s_minEntriesPerChunk) {
+        decodeSequentially(0);
+        return entries;
+    }
+
+    QList<KSycocaEntry *> decoded(offsets.size(), nullptr);
+    KSycocaEntry **out = decoded.data();
+    // Probe with the first entry: if the factory can't decode from an independent cursor, don't bother
+    decodeChunk(0, 1, out);
+    if (!decoded.at(0)) {
+        decodeSequentially(0);
+        return entries;
     }
 
-    // offsetList is needed because createEntry() modifies the stream position
-    qint32 *offsetList = new qint32[entryCount];
-    for (int i = 0; i < entryCount; i++) {
-        (*str) >> offsetList[i];
+    const qsizetype chunkCount = std::min<qsizetype>(maxThreads, offsets.size() / s_minEntriesPerChunk);
+    const qsizetype chunkSize = (offsets.size() - 1 + chunkCount - 1) / chunkCount;
+    QSemaphore done;
+    int started = 0;
+    // The first chunk always runs in this thread, the others if no pool thread is available right now.
+    // Never waiting for queued tasks ensures we can't deadlock when called from a pool thread.
+    for (qsizetype begin = 1 + chunkSize; begin < offsets.size(); begin += chunkSize) {
+        const qsizetype end = std::min(begin + chunkSize, offsets.size());
+        const bool queued = QThreadPool::globalInstance()->tryStart([&decodeChunk, &done, out, begin, end] {
+            decodeChunk(begin, end, out);
+            done.release();
+        });
+        if (queued) {
+            ++started;
+        } else {
+            decodeChunk(begin, end, out);
+        }
     }
+    decodeChunk(1, std::min<qsizetype>(1 + chunkSize, offsets.size()), out);
+    done.acquire(started);
 
-    for (int i = 0; i < entryCount; i++) {
-        KSycocaEntry *newEntry = createEntry(offsetList[i]);
+    for (KSycocaEntry *newEntry : std::as_const(decoded)) {
         if (newEntry) {
-            list.append(KSycocaEntry::Ptr(newEntry));
+            entries.append(newEntry);
+        }
+    }
+    return entries;
+}
+
+QHash<qint32, QByteArray> KSycocaFactory::entryRecords(const QList<qint32> &offsets) const
+{
+    QHash<qint32, QByteArray> records;
+    QDataStream *str = stream();
+    if (!str) {
+        return records;
+    }
+    QList<qint32> sortedOffsets = offsets;
+    std::sort(sortedOffsets.begin(), sortedOffsets.end());
+    records.reserve(sortedOffsets.size());
+    for (qsizetype i = 0; i < sortedOffsets.size(); ++i) {
+        const qint32 begin = sortedOffsets.at(i);
+        const qint32 end = i + 1 < sortedOffsets.size() ? sortedOffsets.at(i + 1) : d->m_endEntryOffset;
+        if (begin < d->m_beginEntryOffset || end <= begin || !str->device()->seek(begin)) {
+            continue;
+        }
+        const QByteArray record = str->device()->read(end - begin);
+        if (record.size() == end - begin) {
+            records.insert(begin, record);
         }
     }
-    delete[] offsetList;
+    return records;
+}
+
+QByteArray KSycocaFactory::encodeEntry(const KSycocaEntry::Ptr &entry)
+{
+    QByteArray record;
+    QBuffer buffer(&record);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream str(&buffer);
+    str.setVersion(QDataStream::Qt_5_3);
+    entry->d_ptr->save(str);
+    return record;
+}
+
+const QByteArray *KSycocaFactory::deltaRecord(int offset) const
+{
+    return m_sycoca->d->m_applyDelta ? m_sycoca->d->m_delta.record(offset) : nullptr;
+}
+
+bool KSycocaFactory::deltaLookup(KSycocaDelta::Dict dict, const QString &key, int *offset) const
+{
+    return m_sycoca->d->m_applyDelta && m_sycoca->d->m_delta.lookup(dict, key, offset);
+}
+
+const KSycocaDelta *KSycocaFactory::delta() const
+{
+    return m_sycoca->d->m_applyDelta ? &m_sycoca->d->m_delta : nullptr;
+}
+
+KSycocaEntry::List KSycocaFactory::allEntries() const
+{
+    const QList<KSycocaEntry *> decoded = decodeEntries(entryOffsets());
+
+    KSycocaEntry::List list;
+    list.reserve(decoded.size());
+    for (KSycocaEntry *newEntry : decoded) {
+        list.append(KSycocaEntry::Ptr(newEntry));
+    }
     return list;
 }
 
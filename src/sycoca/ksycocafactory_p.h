@@ -8,6 +8,7 @@
 #ifndef KSYCOCAFACTORY_H
 #define KSYCOCAFACTORY_H
 
+#include "ksycocadelta_p.h"
 #include "ksycocaresourcelist_p.h"
 #include <QStandardPaths>
 #include <ksycocaentry.h>
@@ -81,11 +82,38 @@ public:
      */
     virtual KSycocaEntry *createEntry(int offset) const = 0;
 
+    /*!
+     * Read an entry from \a str, which must be positioned at \a offset (i.e. on the entry type).
+     *
+     * Unlike createEntry(int), this must not use the shared database stream,
+     * so that entries can be decoded concurrently from independent cursors.
+     * The default implementation returns nullptr, meaning that the factory
+     * doesn't support it and allEntries() decodes sequentially.
+     */
+    virtual KSycocaEntry *decodeEntry(QDataStream &str, int offset) const;
+
     /*!
      * Get a list of all entries from the database.
      */
     virtual KSycocaEntry::List allEntries() const;
 
+    /*!
+     * Returns the offsets of all entries in the database, in the order of the linear index.
+     * Useful for factories which want to decode entries directly into a typed list.
+     */
+    QList<qint32> entryOffsets() const;
+
+    /*!
+     * Returns the raw records of the entries at the given \a offsets (as returned by entryOffsets()),
+     * keyed by offset. A record spans from its offset to the next one, or to the end of the entries.
+     */
+    QHash<qint32, QByteArray> entryRecords(const QList<qint32> &offsets) const;
+
+    /*!
+     * Returns \a entry encoded the way save() writes it into the database
+     */
+    static QByteArray encodeEntry(const KSycocaEntry::Ptr &entry);
+
     /*!
      * Saves all entries it maintains as well as index files
      * for these entries to the stream 'str'.
@@ -132,6 +160,31 @@ public:
 protected:
     QDataStream *stream() const;
 
+    /*!
+     * Decodes the entries at the given \a offsets, in the same order, skipping invalid ones.
+     *
+     * When the database is memory-mapped and the factory implements decodeEntry(),
+     * large lists are split into chunks which are decoded in parallel on the global thread pool.
+     * Otherwise this is equivalent to calling createEntry(int) for every offset.
+     */
+    QList<KSycocaEntry *> decodeEntries(const QList<qint32> &offsets) const;
+
+    /*!
+     * Returns the record replacing the one at \a offset in the database, see KSycocaDelta.
+     * Returns nullptr if the entry wasn't changed; an empty record means the entry was removed.
+     */
+    const QByteArray *deltaRecord(int offset) const;
+
+    /*!
+     * Returns true if the delta changed the slot of \a key in \a dict, see KSycocaDelta::lookup()
+     */
+    bool deltaLookup(KSycocaDelta::Dict dict, const QString &key, int *offset) const;
+
+    /*!
+     * Returns the delta of the database, or nullptr while it isn't applied (kbuildsycoca comparing with the database)
+     */
+    const KSycocaDelta *delta() const;
+
     KSycocaResourceList m_resourceList;
     KSycocaEntryDict *m_entryDict = nullptr;
 
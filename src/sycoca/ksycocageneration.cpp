@@ -0,0 +1,113 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocageneration_p.h"
+#include "sycocadebug.h"
+
+#include <config-ksycoca.h>
+
+#include <QFile>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The counter is the first 8 bytes of the file, written and read atomically
+static const size_t s_fileSize = sizeof(quint64);
+// Shared with other processes through the mapping: a lock would only be private to each of them
+static_assert(std::atomic_ref<quint64>::is_always_lock_free, "the generation counter must be lock-free");
+
+KSycocaGeneration::~KSycocaGeneration()
+{
+    close();
+}
+
+QString KSycocaGeneration::filePath(const QString &databasePath)
+{
+    return databasePath + QLatin1String(".generation");
+}
+
+bool KSycocaGeneration::open(const QString &databasePath)
+{
+    close();
+#if HAVE_MMAP
+    const int fd = ::open(QFile::encodeName(filePath(databasePath)).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= s_fileSize) {
+        void *mapping = mmap(nullptr, s_fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            m_counter = static_cast<quint64 *>(mapping);
+        }
+    }
+    ::close(fd);
+#else
+    Q_UNUSED(databasePath)
+#endif
+    return isOpen();
+}
+
+void KSycocaGeneration::close()
+{
+#if HAVE_MMAP
+    if (m_counter) {
+        munmap(m_counter, s_fileSize);
+        m_counter = nullptr;
+    }
+#endif
+}
+
+quint64 KSycocaGeneration::current() const
+{
+    return m_counter ? std::atomic_ref<quint64>(*m_counter).load(std::memory_order_acquire) : 0;
+}
+
+void KSycocaGeneration::increment(const QString &databasePath)
+{
+#if HAVE_MMAP
+    const QString path = filePath(databasePath);
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        qCWarning(SYCOCA) << "Couldn't open" << path << strerror(errno);
+        return;
+    }
+    // Like the database, keep the file writable by the original user when running via sudo
+    if (qEnvironmentVariableIsSet("SUDO_UID")) {
+        const int uid = qEnvironmentVariableIntValue("SUDO_UID");
+        const int gid = qEnvironmentVariableIntValue("SUDO_GID");
+        if (uid && gid && fchown(fd, uid, gid) != 0) {
+            qCWarning(SYCOCA) << "ERROR changing ownership of" << path << strerror(errno);
+        }
+    }
+    struct stat st;
+    // Never shrink or replace the file: readers keep it mapped
+    if (fstat(fd, &st) != 0 || (size_t(st.st_size) < s_fileSize && ftruncate(fd, s_fileSize) != 0)) {
+        qCWarning(SYCOCA) << "Couldn't resize" << path << strerror(errno);
+        ::close(fd);
+        return;
+    }
+    void *mapping = mmap(nullptr, s_fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        qCWarning(SYCOCA) << "Couldn't map" << path << strerror(errno);
+        return;
+    }
+    std::atomic_ref<quint64>(*static_cast<quint64 *>(mapping)).fetch_add(1, std::memory_order_release);
+    munmap(mapping, s_fileSize);
+#else
+    Q_UNUSED(databasePath)
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCAGENERATION_P_H
+#define KSYCOCAGENERATION_P_H
+
+#include <kservice_export.h>
+
+#include <QString>
+
+/*!
+ * \internal
+ * A counter stored next to a ksycoca database, which kbuildsycoca increments
+ * every time it writes the database or its delta.
+ *
+ * Readers map it once, so that finding out whether the database changed is a single
+ * atomic load instead of a stat() of the database file.
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KSycocaGeneration
+{
+public:
+    KSycocaGeneration() = default;
+    ~KSycocaGeneration();
+    KSycocaGeneration(const KSycocaGeneration &) = delete;
+    KSycocaGeneration &operator=(const KSycocaGeneration &) = delete;
+
+    /*!
+     * Returns the path of the generation file for the database at \a databasePath
+     */
+    static QString filePath(const QString &databasePath);
+
+    /*!
+     * Maps the generation of the database at \a databasePath (read-only).
+     * Returns false if there's none yet, or if mapping isn't supported on this platform.
+     */
+    bool open(const QString &databasePath);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_counter != nullptr;
+    }
+
+    /*!
+     * Returns the current generation, or 0 if not open
+     */
+    quint64 current() const;
+
+    /*!
+     * Increments the generation of the database at \a databasePath, creating the file if needed.
+     * Called by kbuildsycoca once the new database or delta is in place.
+     */
+    static void increment(const QString &databasePath);
+
+private:
+    quint64 *m_counter = nullptr;
+};
+
+#endif
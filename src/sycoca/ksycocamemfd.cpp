@@ -0,0 +1,178 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocamemfd_p.h"
+#include "sycocadebug.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX) && defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+#define KSYCOCA_HAVE_MEMFD 1
+#else
+#define KSYCOCA_HAVE_MEMFD 0
+#endif
+
+// The version and the factory offsets, compared with the database before trusting a memfd
+static const qint64 s_headerSize = 64;
+
+QString KSycocaMemFd::handleFilePath(const QString &databasePath)
+{
+    return databasePath + QLatin1String(".memfd");
+}
+
+bool KSycocaMemFd::isSupported()
+{
+    return KSYCOCA_HAVE_MEMFD;
+}
+
+int KSycocaMemFd::publish(const QString &databasePath)
+{
+#if KSYCOCA_HAVE_MEMFD
+    QFile database(databasePath);
+    if (!database.open(QIODevice::ReadOnly)) {
+        qCWarning(SYCOCA) << "Couldn't open" << databasePath << database.errorString();
+        return -1;
+    }
+    struct stat databaseStat;
+    if (fstat(database.handle(), &databaseStat) != 0) {
+        qCWarning(SYCOCA) << "Couldn't stat" << databasePath << strerror(errno);
+        return -1;
+    }
+    const qint64 lastModified = QFileInfo(database).lastModified().toMSecsSinceEpoch();
+    const QByteArray data = database.readAll();
+    if (data.size() != databaseStat.st_size) {
+        qCWarning(SYCOCA) << databasePath << "changed while copying it";
+        return -1;
+    }
+
+    const int fd = memfd_create("ksycoca", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qCWarning(SYCOCA) << "memfd_create failed:" << strerror(errno);
+        return -1;
+    }
+    qint64 written = 0;
+    while (written < data.size()) {
+        const ssize_t ret = ::write(fd, data.constData() + written, data.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            qCWarning(SYCOCA) << "Couldn't write the memfd:" << strerror(errno);
+            ::close(fd);
+            return -1;
+        }
+        written += ret;
+    }
+    // Readers rely on the contents never changing under their mapping
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        qCWarning(SYCOCA) << "Couldn't seal the memfd:" << strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+
+    QSaveFile handleFile(handleFilePath(databasePath));
+    if (!handleFile.open(QIODevice::WriteOnly)) {
+        qCWarning(SYCOCA) << "Couldn't create" << handleFile.fileName() << handleFile.errorString();
+        ::close(fd);
+        return -1;
+    }
+    handleFile.write(QByteArray::number(QCoreApplication::applicationPid()) + ' ' + QByteArray::number(fd) + ' ' + QByteArray::number(lastModified) + ' '
+                     + QByteArray::number(qint64(databaseStat.st_size)) + ' ' + QByteArray::number(quint64(databaseStat.st_ino)) + '\n');
+    if (!handleFile.commit()) {
+        qCWarning(SYCOCA) << "Couldn't write" << handleFile.fileName() << handleFile.errorString();
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    Q_UNUSED(databasePath)
+    return -1;
+#endif
+}
+
+const char *KSycocaMemFd::map(const QString &databasePath, qint64 databaseLastModified, qint64 *size)
+{
+#if KSYCOCA_HAVE_MEMFD
+    QFile handleFile(handleFilePath(databasePath));
+    if (!handleFile.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    const QList<QByteArray> fields = handleFile.readLine().trimmed().split(' ');
+    QFile database(databasePath);
+    struct stat databaseStat;
+    if (fields.size() != 5 || fields.at(2).toLongLong() != databaseLastModified || !database.open(QIODevice::ReadOnly)
+        || fstat(database.handle(), &databaseStat) != 0 || fields.at(3).toLongLong() != qint64(databaseStat.st_size)
+        || fields.at(4).toULongLong() != quint64(databaseStat.st_ino)) {
+        qCDebug(SYCOCA) << "No memfd for this version of" << databasePath;
+        return nullptr;
+    }
+    const QByteArray header = database.read(s_headerSize);
+    const QByteArray procPath = "/proc/" + fields.at(0) + "/fd/" + fields.at(1);
+    const int fd = ::open(procPath.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qCDebug(SYCOCA) << "Couldn't open" << procPath << strerror(errno);
+        return nullptr;
+    }
+    const int requiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+    const int seals = fcntl(fd, F_GET_SEALS);
+    struct stat st;
+    const char *data = nullptr;
+    if (seals >= 0 && (seals & requiredSeals) == requiredSeals && fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *mapping = st.st_size == databaseStat.st_size ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        // The pid and fd may have been reused since the handle file was written
+        if (mapping != MAP_FAILED && memcmp(mapping, header.constData(), header.size()) != 0) {
+            munmap(mapping, st.st_size);
+            mapping = MAP_FAILED;
+        }
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const char *>(mapping);
+            *size = st.st_size;
+        } else {
+            qCDebug(SYCOCA) << procPath << "isn't a copy of" << databasePath;
+        }
+    } else {
+        qCWarning(SYCOCA) << procPath << "isn't a sealed memfd, ignoring it";
+    }
+    ::close(fd);
+    return data;
+#else
+    Q_UNUSED(databasePath)
+    Q_UNUSED(databaseLastModified)
+    Q_UNUSED(size)
+    return nullptr;
+#endif
+}
+
+void KSycocaMemFd::unpublish(const QString &databasePath, int fd)
+{
+#if KSYCOCA_HAVE_MEMFD
+    QFile handleFile(handleFilePath(databasePath));
+    if (!handleFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QList<QByteArray> fields = handleFile.readLine().trimmed().split(' ');
+    handleFile.close();
+    if (fields.size() >= 2 && fields.at(0).toLongLong() == QCoreApplication::applicationPid() && fields.at(1).toInt() == fd) {
+        handleFile.remove();
+    }
+#else
+    Q_UNUSED(databasePath)
+    Q_UNUSED(fd)
+#endif
+}
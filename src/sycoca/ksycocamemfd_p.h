@@ -0,0 +1,62 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCAMEMFD_P_H
+#define KSYCOCAMEMFD_P_H
+
+#include <kservice_export.h>
+
+#include <QString>
+
+/*!
+ * \internal
+ * Publishes a ksycoca database as a sealed memfd, for the "memfd" strategy (Linux only).
+ *
+ * A long-running kbuildsycoca copies the database into a memfd, seals it against any modification,
+ * and keeps it open. It writes "<pid> <fd> <database mtime> <database size> <database inode>" into a small file
+ * next to the database, so that readers can open the memfd through /proc/<pid>/fd/<fd> and map it read-only,
+ * without copying it and without mapping the database file itself. Readers only use a memfd of the size
+ * of the database, which starts with the same header, in case the pid and fd were reused since.
+ *
+ * Exported for kbuildsycoca and unit tests
+ */
+class KSERVICE_EXPORT KSycocaMemFd
+{
+public:
+    /*!
+     * Returns the path of the file naming the memfd of the database at \a databasePath
+     */
+    static QString handleFilePath(const QString &databasePath);
+
+    /*!
+     * Returns true if memfds can be used on this platform
+     */
+    static bool isSupported();
+
+    /*!
+     * Copies the database at \a databasePath into a new sealed memfd and announces it to readers.
+     * Returns the file descriptor, which must stay open as long as readers may want to open it,
+     * or -1 on error.
+     */
+    static int publish(const QString &databasePath);
+
+    /*!
+     * Maps the memfd published for the database at \a databasePath, last modified at
+     * \a databaseLastModified (ms since epoch), read-only.
+     * Returns nullptr if there's none, or if it belongs to another version of the database.
+     * The mapping must be released with munmap().
+     */
+    static const char *map(const QString &databasePath, qint64 databaseLastModified, qint64 *size);
+
+    /*!
+     * Removes the file naming the memfd of the database at \a databasePath, if it names the memfd \a fd
+     * of this process. Called by kbuildsycoca before closing it.
+     */
+    static void unpublish(const QString &databasePath, int fd);
+};
+
+#endif
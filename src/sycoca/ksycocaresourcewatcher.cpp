@@ -0,0 +1,94 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocaresourcewatcher_p.h"
+#include "sycocadebug.h"
+
+#include <KDirWatch>
+
+Q_GLOBAL_STATIC(KSycocaResourceWatcher, s_resourceWatcher)
+
+KSycocaResourceWatcher::KSycocaResourceWatcher()
+{
+    m_thread.setObjectName(QStringLiteral("KSycoca resource watcher"));
+    m_thread.start(QThread::LowPriority);
+    m_context.moveToThread(&m_thread);
+    // KDirWatch delivers its notifications in the thread which created it
+    QMetaObject::invokeMethod(
+        &m_context,
+        [this]() {
+            m_dirWatch = new KDirWatch;
+            auto changed = [this]() {
+                m_changeCount.fetch_add(1, std::memory_order_acq_rel);
+            };
+            QObject::connect(m_dirWatch, &KDirWatch::dirty, &m_context, changed);
+            QObject::connect(m_dirWatch, &KDirWatch::created, &m_context, changed);
+            QObject::connect(m_dirWatch, &KDirWatch::deleted, &m_context, changed);
+        },
+        Qt::BlockingQueuedConnection);
+}
+
+KSycocaResourceWatcher::~KSycocaResourceWatcher()
+{
+    QMetaObject::invokeMethod(
+        &m_context,
+        [this]() {
+            delete m_dirWatch;
+            m_dirWatch = nullptr;
+            m_context.moveToThread(nullptr); // so that it can be destroyed here
+        },
+        Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+KSycocaResourceWatcher *KSycocaResourceWatcher::self()
+{
+    return s_resourceWatcher.isDestroyed() ? nullptr : s_resourceWatcher();
+}
+
+void KSycocaResourceWatcher::watch(const QStringList &dirs, const QStringList &files)
+{
+    // Held until the watches are in place, so that another thread doesn't return before that either
+    QMutexLocker locker(&m_mutex);
+    QStringList newDirs;
+    QStringList newFiles;
+    for (const QString &dir : dirs) {
+        if (!m_watched.contains(dir)) {
+            m_watched.insert(dir);
+            newDirs.append(dir);
+        }
+    }
+    for (const QString &file : files) {
+        if (!m_watched.contains(file)) {
+            m_watched.insert(file);
+            newFiles.append(file);
+        }
+    }
+    if (newDirs.isEmpty() && newFiles.isEmpty()) {
+        return;
+    }
+    qCDebug(SYCOCA) << "Watching" << newDirs << newFiles;
+    QMetaObject::invokeMethod(
+        &m_context,
+        [this, newDirs, newFiles]() {
+            addWatches(newDirs, newFiles);
+        },
+        Qt::BlockingQueuedConnection);
+}
+
+void KSycocaResourceWatcher::addWatches(const QStringList &dirs, const QStringList &files)
+{
+    // WatchFiles too, for files edited in place
+    for (const QString &dir : dirs) {
+        m_dirWatch->addDir(dir, KDirWatch::WatchSubDirs | KDirWatch::WatchFiles);
+    }
+    // KDirWatch also tells when files which don't exist yet are created
+    for (const QString &file : files) {
+        m_dirWatch->addFile(file);
+    }
+}
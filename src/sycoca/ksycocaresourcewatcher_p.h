@@ -0,0 +1,72 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCARESOURCEWATCHER_P_H
+#define KSYCOCARESOURCEWATCHER_P_H
+
+#include <kservice_export.h>
+
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+
+class KDirWatch;
+
+/*!
+ * \internal
+ * Watches the files ksycoca databases are built from (resource directories, mimeapps.list files)
+ * and the databases themselves, for the whole process.
+ *
+ * The KDirWatch lives in a thread of its own, so that notifications arrive whether or not
+ * the threads using KSycoca run an event loop. Every notification increments changeCount(),
+ * which KSycoca compares with the count it saw when it last found its database up to date:
+ * as long as they're equal, nothing needs to be checked.
+ *
+ * Exported for unit tests
+ */
+class KSERVICE_EXPORT KSycocaResourceWatcher
+{
+public:
+    KSycocaResourceWatcher();
+    ~KSycocaResourceWatcher();
+
+    /*!
+     * Returns the instance for this process, or nullptr while it's being destroyed
+     */
+    static KSycocaResourceWatcher *self();
+
+    /*!
+     * Returns the number of changes to the watched files so far
+     */
+    quint64 changeCount() const
+    {
+        return m_changeCount.load(std::memory_order_acquire);
+    }
+
+    /*!
+     * Starts watching \a dirs (recursively) and \a files, which may not exist yet.
+     * Returns once the watches are in place, changes made after that increment changeCount().
+     * Can be called from any thread.
+     */
+    void watch(const QStringList &dirs, const QStringList &files);
+
+private:
+    void addWatches(const QStringList &dirs, const QStringList &files);
+
+    QThread m_thread;
+    QObject m_context; // lives in m_thread
+    KDirWatch *m_dirWatch = nullptr; // lives in m_thread
+    QMutex m_mutex; // for m_watched, held while adding watches
+    QSet<QString> m_watched;
+    std::atomic<quint64> m_changeCount{0};
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "ksycocastatistics_p.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+KSycocaStatistics::Counters s_counters;
+
+const char *const s_dictNames[KSycocaStatistics::DictCount] = {
+    "services by name",
+    "services by desktop name",
+    "services by desktop path",
+    "services by menu id",
+    "service groups by path",
+    "service groups by base name",
+    "mime types by name",
+};
+
+const char *const s_entryTypeNames[KSycocaStatistics::EntryTypeCount] = {
+    "service",
+    "service group",
+    "mime type",
+};
+
+void dump(QTextStream &str, const KSycoca::Statistics &stats)
+{
+    str << "KSycoca statistics for " << QCoreApplication::applicationName() << " (" << QCoreApplication::applicationPid() << ")\n";
+    for (int i = 0; i < KSycocaStatistics::DictCount; ++i) {
+        const auto dict = KSycoca::Statistics::Dict(i);
+        str << "  lookups of " << s_dictNames[i] << ": " << stats.probes(dict) << " (" << stats.hits(dict) << " hits, " << stats.misses(dict)
+            << " misses)\n";
+    }
+    for (int i = 0; i < KSycocaStatistics::EntryTypeCount; ++i) {
+        str << "  decoded " << s_entryTypeNames[i] << " entries: " << stats.decodedEntries(KSycoca::Statistics::EntryType(i)) << '\n';
+    }
+    str << "  decoded bytes: " << stats.value(KSycoca::Statistics::DecodedBytes) << '\n'
+        << "  duplicate list steps: " << stats.value(KSycoca::Statistics::DuplicateListSteps) << '\n'
+        << "  ensureCacheValid calls: " << stats.value(KSycoca::Statistics::EnsureCacheValidCalls) << '\n'
+        << "  directory checks: " << stats.value(KSycoca::Statistics::DirectoryChecks) << " in "
+        << stats.value(KSycoca::Statistics::DirectoryCheckNSecs) / 1000 << " us\n"
+        << "  rebuilds: " << stats.value(KSycoca::Statistics::Rebuilds) << '\n'
+        << "  reopens: " << stats.value(KSycoca::Statistics::Reopens) << '\n';
+}
+
+// Prints the statistics when the process exits, if KSYCOCA_STATISTICS is set
+struct ExitDumper {
+    ~ExitDumper()
+    {
+        const QString target = qEnvironmentVariable("KSYCOCA_STATISTICS");
+        if (target.isEmpty() || target == QLatin1String("0")) {
+            return;
+        }
+        QString output;
+        QTextStream str(&output);
+        dump(str, KSycocaStatistics::snapshot());
+        str.flush();
+        if (target == QLatin1String("1")) {
+            fputs(output.toLocal8Bit().constData(), stderr);
+            return;
+        }
+        QFile file(target);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            file.write(output.toUtf8());
+        }
+    }
+};
+ExitDumper s_exitDumper;
+}
+
+KSycocaStatistics::Counters &KSycocaStatistics::counters()
+{
+    return s_counters;
+}
+
+KSycoca::Statistics KSycocaStatistics::snapshot()
+{
+    const auto load = [](const std::atomic<quint64> &counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+
+    KSycoca::Statistics stats;
+    KSycocaStatisticsPrivate *d = KSycocaStatisticsPrivate::get(stats);
+    for (int dict = 0; dict < DictCount; ++dict) {
+        d->probes[dict] = load(s_counters.probes[dict]);
+        // Read after the probes, a concurrent lookup may have been counted in between
+        d->hits[dict] = std::min(load(s_counters.hits[dict]), d->probes[dict]);
+    }
+    for (int type = 0; type < EntryTypeCount; ++type) {
+        d->entries[type] = load(s_counters.entries[type]);
+    }
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        d->counters[counter] = load(s_counters.counters[counter]);
+    }
+    return stats;
+}
+
+KSycoca::Statistics::Statistics()
+    : d(new KSycocaStatisticsPrivate)
+{
+}
+
+KSycoca::Statistics::Statistics(const Statistics &other) = default;
+
+KSycoca::Statistics &KSycoca::Statistics::operator=(const Statistics &other) = default;
+
+KSycoca::Statistics::~Statistics() = default;
+
+quint64 KSycoca::Statistics::probes(Dict dict) const
+{
+    return d->probes[dict];
+}
+
+quint64 KSycoca::Statistics::hits(Dict dict) const
+{
+    return d->hits[dict];
+}
+
+quint64 KSycoca::Statistics::misses(Dict dict) const
+{
+    return d->probes[dict] - d->hits[dict];
+}
+
+quint64 KSycoca::Statistics::decodedEntries(EntryType type) const
+{
+    return d->entries[type];
+}
+
+quint64 KSycoca::Statistics::value(Counter counter) const
+{
+    return d->counters[counter];
+}
+
+KSycoca::Statistics KSycoca::statistics()
+{
+    return KSycocaStatistics::snapshot();
+}
@@ -0,0 +1,79 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#ifndef KSYCOCASTATISTICS_P_H
+#define KSYCOCASTATISTICS_P_H
+
+#include "ksycoca.h"
+
+#include <atomic>
+
+/*!
+ * \internal
+ * The counters behind KSycoca::statistics().
+ *
+ * They are process-wide relaxed atomics: incrementing one costs about as much as an uncontended
+ * memory write, which is negligible next to decoding an entry from the database.
+ */
+namespace KSycocaStatistics
+{
+constexpr int DictCount = KSycoca::Statistics::MimeTypesByName + 1;
+constexpr int EntryTypeCount = KSycoca::Statistics::MimeTypeEntry + 1;
+constexpr int CounterCount = KSycoca::Statistics::Reopens + 1;
+
+struct Counters {
+    std::atomic<quint64> probes[DictCount] = {};
+    std::atomic<quint64> hits[DictCount] = {};
+    std::atomic<quint64> entries[EntryTypeCount] = {};
+    std::atomic<quint64> counters[CounterCount] = {};
+};
+
+Counters &counters();
+
+inline void add(KSycoca::Statistics::Counter counter, quint64 n = 1)
+{
+    counters().counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+// A lookup, which hit if the dict gave an entry which really matches the key
+inline void recordLookup(KSycoca::Statistics::Dict dict, bool hit)
+{
+    Counters &c = counters();
+    c.probes[dict].fetch_add(1, std::memory_order_relaxed);
+    if (hit) {
+        c.hits[dict].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void recordEntry(KSycoca::Statistics::EntryType type, qint64 bytes)
+{
+    Counters &c = counters();
+    c.entries[type].fetch_add(1, std::memory_order_relaxed);
+    if (bytes > 0) {
+        c.counters[KSycoca::Statistics::DecodedBytes].fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+KSycoca::Statistics snapshot();
+}
+
+// The values of a KSycoca::Statistics, read from the counters at some point
+class KSycocaStatisticsPrivate : public QSharedData
+{
+public:
+    static KSycocaStatisticsPrivate *get(KSycoca::Statistics &stats)
+    {
+        return stats.d.data();
+    }
+
+    quint64 probes[KSycocaStatistics::DictCount] = {};
+    quint64 hits[KSycocaStatistics::DictCount] = {};
+    quint64 entries[KSycocaStatistics::EntryTypeCount] = {};
+    quint64 counters[KSycocaStatistics::CounterCount] = {};
+};
+
+#endif
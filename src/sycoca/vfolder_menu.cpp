@@ -6,6 +6,7 @@
 */
 
 #include "kbuildsycocainterface_p.h"
+#include "ksycocadirectoryscan_p.h"
 #include "kservicefactory_p.h"
 #include "sycocadebug.h"
 #include "vfolder_menu_p.h"
@@ -903,6 +904,22 @@ void VFolderMenu::loadApplications(const QString &dir, const QString &prefix)
 {
     qCDebug(SYCOCA) << "Looking up applications under" << dir;
 
+    const KSycocaDirectoryScan *scan = m_kbuildsycocaInterface->directoryScan();
+    if (const KSycocaDirectoryScan::Entry *dirEntry = scan ? scan->entry(dir) : nullptr) {
+        for (const QString &fn : dirEntry->children) {
+            const QString path = KSycocaDirectoryScan::childPath(dir, fn);
+            const KSycocaDirectoryScan::Entry *child = scan->entry(path);
+            if (child->isDir && !child->isSymLink) {
+                loadApplications(path, prefix + fn + QLatin1Char('-'));
+            } else if (child->isFile && fn.endsWith(QLatin1String(".desktop"))) {
+                if (KService::Ptr service = m_kbuildsycocaInterface->createService(path)) {
+                    addApplication(prefix + fn, service);
+                }
+            }
+        }
+        return;
+    }
+
     QDirIterator it(dir);
     while (it.hasNext()) {
         it.next();
@@ -0,0 +1,386 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+/*
+ * Generates a synthetic XDG tree with many applications, for scaling tests and benchmarks:
+ *
+ *   ksycoca_datagen --apps 10000 /tmp/xdg
+ *   eval $(ksycoca_datagen --apps 10000 --print-env /tmp/xdg)
+ *
+ * The tree contains three data layers (user, local, system), where the upper layers override
+ * or hide some of the applications of the lower ones, mimeapps.list files in the config dir
+ * and the data layers, and an applications.menu with Include/Exclude rules.
+ *
+ * Application i is org.kde.bench<i>.desktop. Half of the applications handle text/plain,
+ * a fifth image/png, and all application/x-bench<i % 50>, like in benchmarks/ksycocabenchmark.
+ * The output only depends on the options, so runs can be compared.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <iterator>
+
+static const char *const s_mainCategories[] = {"Utility", "Development", "Graphics", "Office", "Network", "AudioVideo", "Game", "System", "Education", "Settings"};
+static const char *const s_extraCategories[] =
+    {"TextEditor", "IDE", "Viewer", "RasterGraphics", "WebBrowser", "Email", "Player", "ArcadeGame", "BoardGame", "Monitor", "Math", "Archiving"};
+static const char *const s_mimeTypes[] = {
+    "text/html",
+    "text/x-c++src",
+    "text/x-python",
+    "text/markdown",
+    "application/pdf",
+    "application/json",
+    "application/xml",
+    "application/zip",
+    "application/x-tar",
+    "application/vnd.oasis.opendocument.text",
+    "application/vnd.oasis.opendocument.spreadsheet",
+    "image/jpeg",
+    "image/svg+xml",
+    "image/gif",
+    "image/webp",
+    "audio/mpeg",
+    "audio/flac",
+    "audio/ogg",
+    "video/mp4",
+    "video/x-matroska",
+    "inode/directory",
+    "x-scheme-handler/http",
+    "x-scheme-handler/https",
+    "x-scheme-handler/mailto",
+};
+static const char *const s_languages[] = {"de", "fr", "es", "it", "pt_BR", "ja", "zh_CN", "ru", "pl", "nl", "sv", "cs", "uk", "ko", "tr", "ca"};
+// The directories used for nesting, outermost first
+static const char *const s_subdirs[] = {"kde", "vendor", "extra", "deep"};
+
+class Generator
+{
+public:
+    int appCount = 1000;
+    int depth = 2;
+    int languages = 8;
+    double overrideRatio = 0.05;
+    QString root;
+
+    bool run();
+
+private:
+    QString dataDir(const QString &layer) const
+    {
+        return root + QLatin1String("/data-") + layer;
+    }
+    QString configDir() const
+    {
+        return root + QLatin1String("/config");
+    }
+
+    QString subdirFor(int i) const;
+    QString desktopFileName(int i) const
+    {
+        return QStringLiteral("org.kde.bench%1.desktop").arg(i);
+    }
+    QString menuId(int i) const
+    {
+        QString id = subdirFor(i);
+        id.replace(QLatin1Char('/'), QLatin1Char('-'));
+        return id + desktopFileName(i);
+    }
+
+    bool writeFile(const QString &path, const QString &contents);
+    bool writeApp(const QString &layer, int i, const QString &nameSuffix, bool hidden);
+    bool writeMimeAppsList(const QString &path, int offset);
+    bool writeMenus();
+
+    QStringList mimeTypesFor(int i);
+    QString mainCategory(int i) const
+    {
+        return QLatin1String(s_mainCategories[i % std::size(s_mainCategories)]);
+    }
+
+    QRandomGenerator m_random{42};
+};
+
+QString Generator::subdirFor(int i) const
+{
+    // One in ten applications is nested one level deep, one in a hundred two levels...
+    QString subdir;
+    for (int level = 0, n = i + 1; level < depth && level < int(std::size(s_subdirs)) && n % 10 == 0; ++level, n /= 10) {
+        subdir += QLatin1String(s_subdirs[level]) + QLatin1Char('/');
+    }
+    return subdir;
+}
+
+bool Generator::writeFile(const QString &path, const QString &contents)
+{
+    const QString dir = path.left(path.lastIndexOf(QLatin1Char('/')));
+    if (!QDir().mkpath(dir)) {
+        qWarning("Couldn't create %s", qPrintable(dir));
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Couldn't write %s: %s", qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+    file.write(contents.toUtf8());
+    return true;
+}
+
+QStringList Generator::mimeTypesFor(int i)
+{
+    QStringList mimeTypes{QStringLiteral("application/x-bench%1").arg(i % 50)};
+    if (i % 2 == 0) {
+        mimeTypes << QStringLiteral("text/plain");
+    }
+    if (i % 5 == 0) {
+        mimeTypes << QStringLiteral("image/png");
+    }
+    // Most applications handle a few types, some handle dozens
+    const int extra = m_random.bounded(100) < 5 ? int(std::size(s_mimeTypes)) : m_random.bounded(5);
+    for (int j = 0; j < extra; ++j) {
+        const QString mimeType = QLatin1String(s_mimeTypes[m_random.bounded(int(std::size(s_mimeTypes)))]);
+        if (!mimeTypes.contains(mimeType)) {
+            mimeTypes << mimeType;
+        }
+    }
+    return mimeTypes;
+}
+
+bool Generator::writeApp(const QString &layer, int i, const QString &nameSuffix, bool hidden)
+{
+    QString contents;
+    QTextStream str(&contents);
+    str << "[Desktop Entry]\n"
+        << "Type=Application\n"
+        << "Name=Benchmark App " << i << nameSuffix << '\n';
+    if (hidden) {
+        str << "Hidden=true\n";
+        str.flush();
+        return writeFile(dataDir(layer) + QLatin1String("/applications/") + subdirFor(i) + desktopFileName(i), contents);
+    }
+    str << "GenericName=Generated Application\n"
+        << "Comment=Generated for testing how ksycoca scales\n";
+    for (int l = 0; l < languages && l < int(std::size(s_languages)); ++l) {
+        const char *lang = s_languages[l];
+        str << "Name[" << lang << "]=Benchmark App " << i << " (" << lang << ")\n"
+            << "GenericName[" << lang << "]=Generated Application (" << lang << ")\n"
+            << "Comment[" << lang << "]=Generated (" << lang << ")\n";
+    }
+    str << "Exec=bench" << i << " %U\n"
+        << "Icon=bench" << i << '\n'
+        << "Keywords=bench;generated;app" << i << ";\n";
+
+    const int showIn = m_random.bounded(100);
+    if (showIn < 10) {
+        str << "OnlyShowIn=KDE;\n";
+    } else if (showIn < 15) {
+        str << "NotShowIn=GNOME;\n";
+    } else if (showIn < 17) {
+        str << "NoDisplay=true\n";
+    }
+
+    str << "Categories=Qt;KDE;" << mainCategory(i) << ';';
+    if (m_random.bounded(2)) {
+        str << s_extraCategories[m_random.bounded(int(std::size(s_extraCategories)))] << ';';
+    }
+    if (showIn >= 15 && showIn < 17) {
+        str << "X-Generated-Hidden;"; // excluded by the menu rules
+    }
+    str << '\n';
+    str << "MimeType=" << mimeTypesFor(i).join(QLatin1Char(';')) << ";\n";
+
+    // A fifth of the applications have actions
+    const int actionCount = m_random.bounded(100) < 20 ? 1 + m_random.bounded(3) : 0;
+    if (actionCount > 0) {
+        str << "Actions=";
+        for (int a = 0; a < actionCount; ++a) {
+            str << "action" << a << ';';
+        }
+        str << '\n';
+        for (int a = 0; a < actionCount; ++a) {
+            str << "\n[Desktop Action action" << a << "]\n"
+                << "Name=Action " << a << '\n';
+            for (int l = 0; l < languages && l < int(std::size(s_languages)); ++l) {
+                str << "Name[" << s_languages[l] << "]=Action " << a << " (" << s_languages[l] << ")\n";
+            }
+            str << "Exec=bench" << i << " --action" << a << '\n';
+        }
+    }
+    str.flush();
+    return writeFile(dataDir(layer) + QLatin1String("/applications/") + subdirFor(i) + desktopFileName(i), contents);
+}
+
+bool Generator::writeMimeAppsList(const QString &path, int offset)
+{
+    // Different layers prefer different applications, so that the files have to be merged
+    QString contents;
+    QTextStream str(&contents);
+    str << "[Default Applications]\n";
+    for (int m = 0; m < int(std::size(s_mimeTypes)); ++m) {
+        str << s_mimeTypes[m] << '=' << menuId((m * 7 + offset) % appCount) << ";\n";
+    }
+    str << "\n[Added Associations]\n"
+        << "text/plain=" << menuId((offset + 1) % appCount) << ';' << menuId((offset + 3) % appCount) << ";\n";
+    for (int m = 0; m < 50 && m < appCount; ++m) {
+        str << "application/x-bench" << m << '=' << menuId((m + offset) % appCount) << ";\n";
+    }
+    str << "\n[Removed Associations]\n"
+        << "text/plain=" << menuId(offset % appCount) << ";\n"
+        << "image/png=" << menuId((offset + 5) % appCount) << ";\n";
+    str.flush();
+    return writeFile(path, contents);
+}
+
+bool Generator::writeMenus()
+{
+    QString contents;
+    QTextStream str(&contents);
+    str << "<!DOCTYPE Menu PUBLIC \"-//freedesktop//DTD Menu 1.0//EN\"\n"
+        << "  \"http://www.freedesktop.org/standards/menu-spec/1.0/menu.dtd\">\n"
+        << "<Menu>\n"
+        << "  <Name>Applications</Name>\n"
+        << "  <DefaultAppDirs/>\n"
+        << "  <DefaultDirectoryDirs/>\n"
+        << "  <DefaultMergeDirs/>\n";
+    for (const char *category : s_mainCategories) {
+        str << "  <Menu>\n"
+            << "    <Name>" << category << "</Name>\n"
+            << "    <Include>\n"
+            << "      <And>\n"
+            << "        <Category>" << category << "</Category>\n"
+            << "        <Not><Category>X-Generated-Hidden</Category></Not>\n"
+            << "      </And>\n"
+            << "    </Include>\n"
+            << "    <Exclude>\n";
+        // Exclude a few of the applications the rule includes
+        for (int i = 0; i < appCount; i += 97) {
+            if (mainCategory(i) == QLatin1String(category)) {
+                str << "      <Filename>" << menuId(i) << "</Filename>\n";
+            }
+        }
+        str << "    </Exclude>\n";
+        // And a submenu for the applications of this category with some of the extra categories
+        str << "    <Menu>\n"
+            << "      <Name>More</Name>\n"
+            << "      <Include>\n"
+            << "        <And>\n"
+            << "          <Category>" << category << "</Category>\n"
+            << "          <Or>\n";
+        for (int e = 0; e < int(std::size(s_extraCategories)); e += 3) {
+            str << "            <Category>" << s_extraCategories[e] << "</Category>\n";
+        }
+        str << "          </Or>\n"
+            << "        </And>\n"
+            << "      </Include>\n"
+            << "    </Menu>\n"
+            << "  </Menu>\n";
+    }
+    str << "  <Menu>\n"
+        << "    <Name>Other</Name>\n"
+        << "    <OnlyUnallocated/>\n"
+        << "    <Include><All/></Include>\n"
+        << "  </Menu>\n"
+        << "</Menu>\n";
+    str.flush();
+    if (!writeFile(configDir() + QLatin1String("/menus/applications.menu"), contents)) {
+        return false;
+    }
+
+    // A merged menu, like the ones installed by applications
+    QString merged;
+    QTextStream mergedStr(&merged);
+    mergedStr << "<!DOCTYPE Menu PUBLIC \"-//freedesktop//DTD Menu 1.0//EN\"\n"
+              << "  \"http://www.freedesktop.org/standards/menu-spec/1.0/menu.dtd\">\n"
+              << "<Menu>\n"
+              << "  <Name>Applications</Name>\n"
+              << "  <Menu>\n"
+              << "    <Name>Favorites</Name>\n"
+              << "    <Include>\n";
+    for (int i = 0; i < appCount; i += 53) {
+        mergedStr << "      <Filename>" << menuId(i) << "</Filename>\n";
+    }
+    mergedStr << "    </Include>\n"
+              << "  </Menu>\n"
+              << "</Menu>\n";
+    mergedStr.flush();
+    return writeFile(configDir() + QLatin1String("/menus/applications-merged/generated-favorites.menu"), merged);
+}
+
+bool Generator::run()
+{
+    // The system layer has all the applications
+    for (int i = 0; i < appCount; ++i) {
+        if (!writeApp(QStringLiteral("system"), i, QString(), false)) {
+            return false;
+        }
+    }
+
+    // The local and user layers override some of them, and hide a fifth of those
+    const int overrides = int(appCount * overrideRatio);
+    for (const QString &layer : {QStringLiteral("local"), QStringLiteral("user")}) {
+        for (int o = 0; o < overrides; ++o) {
+            const int i = m_random.bounded(appCount);
+            if (!writeApp(layer, i, QLatin1String(" (") + layer + QLatin1Char(')'), o % 5 == 4)) {
+                return false;
+            }
+        }
+    }
+
+    return writeMimeAppsList(configDir() + QLatin1String("/mimeapps.list"), 2) //
+        && writeMimeAppsList(configDir() + QLatin1String("/kde-mimeapps.list"), 4)
+        && writeMimeAppsList(dataDir(QStringLiteral("system")) + QLatin1String("/applications/mimeapps.list"), 0)
+        && writeMimeAppsList(dataDir(QStringLiteral("user")) + QLatin1String("/applications/mimeapps.list"), 6) //
+        && writeMenus();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Generates a synthetic XDG tree with many applications"));
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringLiteral("apps"), QStringLiteral("Number of applications"), QStringLiteral("count"), QStringLiteral("1000")));
+    parser.addOption(QCommandLineOption(QStringLiteral("depth"), QStringLiteral("Nesting depth of applications subdirectories"), QStringLiteral("levels"), QStringLiteral("2")));
+    parser.addOption(QCommandLineOption(QStringLiteral("languages"), QStringLiteral("Number of translations"), QStringLiteral("count"), QStringLiteral("8")));
+    parser.addOption(QCommandLineOption(QStringLiteral("overrides"),
+                                        QStringLiteral("Fraction of the applications overridden by each upper layer"),
+                                        QStringLiteral("ratio"),
+                                        QStringLiteral("0.05")));
+    parser.addOption(QCommandLineOption(QStringLiteral("print-env"), QStringLiteral("Only print the environment variables to use the tree")));
+    parser.addPositionalArgument(QStringLiteral("root"), QStringLiteral("Directory to create the tree in"));
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    Generator generator;
+    generator.root = QDir(parser.positionalArguments().constFirst()).absolutePath();
+    generator.appCount = qMax(1, parser.value(QStringLiteral("apps")).toInt());
+    generator.depth = parser.value(QStringLiteral("depth")).toInt();
+    generator.languages = parser.value(QStringLiteral("languages")).toInt();
+    generator.overrideRatio = parser.value(QStringLiteral("overrides")).toDouble();
+
+    if (!parser.isSet(QStringLiteral("print-env"))) {
+        if (!generator.run()) {
+            return 1;
+        }
+    }
+
+    // The user layer comes first in XDG_DATA_DIRS, so that this also works in QStandardPaths test mode
+    QTextStream out(stdout);
+    out << "export XDG_DATA_DIRS=" << generator.root << "/data-user:" << generator.root << "/data-local:" << generator.root << "/data-system\n"
+        << "export XDG_CONFIG_DIRS=" << generator.root << "/config\n"
+        << "export XDG_CURRENT_DESKTOP=KDE\n";
+    return 0;
+}
@@ -0,0 +1,607 @@
+/*
+    This file is part of the KDE project
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+/*
+ * Reports what a ksycoca database is made of, to find out why it is large and which lookups are slow:
+ *
+ *   ksycoca-stat                      # the database KSycoca would use in this environment
+ *   ksycoca-stat --top 20 ~/.cache/ksycoca6_en_XXX
+ *
+ * For each factory, it prints the size of its entries and of each field of them, and the quality
+ * of its hash tables (KSycocaDict): load factor, hashList length and the duplicate lists,
+ * which every lookup of a key in them walks, comparing strings.
+ * For services, it also prints the offer lists of the MIME types with most applications.
+ *
+ * The file is opened read-only and parsed directly, so this follows the format written by
+ * KBuildSycoca::save(), the build factories and KSycocaDict::save().
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QLocale>
+#include <QMap>
+#include <QTextStream>
+#include <QVariant>
+
+#include <kserviceaction.h>
+#include <ksycoca.h>
+#include <ksycocadelta_p.h>
+#include <ksycocatype.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+QString factoryName(qint32 id)
+{
+    switch (id) {
+    case KST_KServiceFactory:
+        return QStringLiteral("services");
+    case KST_KServiceGroupFactory:
+        return QStringLiteral("service groups");
+    case KST_KMimeTypeFactory:
+        return QStringLiteral("MIME types");
+    case KST_CTimeInfo:
+        return QStringLiteral("file times");
+    }
+    return QStringLiteral("factory %1").arg(id);
+}
+
+QString entryTypeName(qint32 type)
+{
+    switch (type) {
+    case KST_KService:
+        return QStringLiteral("service");
+    case KST_KServiceGroup:
+        return QStringLiteral("service group");
+    case KST_KMimeTypeEntry:
+        return QStringLiteral("MIME type");
+    }
+    return QStringLiteral("type %1").arg(type);
+}
+
+// Bytes used by each field of the entries of one type, in the order of the record
+struct FieldSizes {
+    void add(const QString &field, qint64 bytes)
+    {
+        if (!sizes.contains(field)) {
+            fields.append(field);
+        }
+        sizes[field] += bytes;
+    }
+
+    QStringList fields;
+    QHash<QString, qint64> sizes;
+};
+
+struct Entry {
+    qint32 offset;
+    qint32 type;
+    qint64 size;
+    QString path;
+};
+
+class Inspector
+{
+public:
+    Inspector(QIODevice *device, int topCount)
+        : m_str(device)
+        , m_size(device->size())
+        , m_topCount(topCount)
+        , m_out(stdout)
+    {
+        m_str.setVersion(QDataStream::Qt_5_3);
+    }
+
+    bool run();
+
+private:
+    struct Factory {
+        qint32 id;
+        qint32 offset;
+        qint64 end;
+    };
+
+    bool readHeader();
+    bool inspectFactory(const Factory &factory);
+    void inspectEntries(qint32 endOffset, const QList<qint32> &offsets);
+    FieldSizes readRecord(Entry &entry);
+    void inspectDict(const QString &name, qint32 offset);
+    void inspectOfferList(qint32 offset);
+    void inspectTimes(qint32 offset);
+    QString mimeTypeName(qint32 offset);
+
+    bool ok() const
+    {
+        return m_str.status() == QDataStream::Ok;
+    }
+    QString size(qint64 bytes) const
+    {
+        return QStringLiteral("%1 bytes (%2, %3%)")
+            .arg(bytes)
+            .arg(QLocale().formattedDataSize(bytes))
+            .arg(QString::number(100.0 * bytes / std::max<qint64>(m_size, 1), 'f', 1));
+    }
+
+    QDataStream m_str;
+    const qint64 m_size;
+    const int m_topCount;
+    QTextStream m_out;
+    QList<Factory> m_factories;
+};
+
+bool Inspector::run()
+{
+    qint32 version;
+    m_str >> version;
+    m_out << "size: " << size(m_size) << '\n';
+    m_out << "version: " << version;
+    if (version != KSycoca::version()) {
+        m_out << " (this build writes " << KSycoca::version() << ", the report may be wrong)";
+    }
+    m_out << '\n';
+
+    // The offsets of the factories, then the header
+    while (ok()) {
+        qint32 id;
+        m_str >> id;
+        if (id == 0) {
+            break;
+        }
+        qint32 offset;
+        m_str >> offset;
+        m_factories.append(Factory{id, offset, m_size});
+    }
+    if (!readHeader()) {
+        return false;
+    }
+
+    // A factory ends where the next one starts
+    QList<Factory> sorted = m_factories;
+    std::sort(sorted.begin(), sorted.end(), [](const Factory &a, const Factory &b) {
+        return a.offset < b.offset;
+    });
+    for (int i = 0; i + 1 < sorted.count(); ++i) {
+        sorted[i].end = sorted.at(i + 1).offset;
+    }
+    for (const Factory &factory : std::as_const(sorted)) {
+        if (!inspectFactory(factory)) {
+            return false;
+        }
+    }
+    m_out.flush();
+    return true;
+}
+
+bool Inspector::readHeader()
+{
+    const qint64 start = m_str.device()->pos();
+    QString prefixes;
+    qint64 timeStamp;
+    QString language;
+    quint32 updateSignature;
+    m_str >> prefixes >> timeStamp >> language >> updateSignature;
+
+    QStringList dirs;
+    m_str >> dirs;
+    QList<qint64> dirTimes(dirs.count());
+    for (qint64 &mtime : dirTimes) {
+        m_str >> mtime;
+    }
+    QStringList files;
+    m_str >> files;
+    QList<qint64> fileTimes(files.count());
+    for (qint64 &mtime : fileTimes) {
+        m_str >> mtime;
+    }
+    if (!ok()) {
+        qWarning() << "The header of the database is truncated or corrupt";
+        return false;
+    }
+
+    const auto time = [](qint64 msecs) {
+        // Negative for dirs and files whose contents are compared, see KSycocaContentHash
+        if (msecs < 0) {
+            return QStringLiteral("(contents)").leftJustified(23);
+        }
+        return QDateTime::fromMSecsSinceEpoch(msecs).toString(Qt::ISODateWithMs);
+    };
+    m_out << "built: " << time(timeStamp) << ", language " << language << ", update signature " << updateSignature << '\n';
+    m_out << "header: " << size(m_str.device()->pos() - start) << '\n';
+    m_out << "XDG_DATA_DIRS: " << prefixes << '\n';
+    m_out << "\nresource directories (" << dirs.count() << "):\n";
+    for (int i = 0; i < dirs.count(); ++i) {
+        m_out << "  " << time(dirTimes.at(i)) << "  " << dirs.at(i) << '\n';
+    }
+    m_out << "\nextra files (" << files.count() << "):\n";
+    for (int i = 0; i < files.count(); ++i) {
+        m_out << "  " << time(fileTimes.at(i)) << "  " << files.at(i) << '\n';
+    }
+    return true;
+}
+
+bool Inspector::inspectFactory(const Factory &factory)
+{
+    m_out << "\n== " << factoryName(factory.id) << ": " << size(factory.end - factory.offset) << '\n';
+
+    m_str.device()->seek(factory.offset);
+    qint32 dictOffset;
+    qint32 beginEntryOffset;
+    qint32 endEntryOffset;
+    m_str >> dictOffset >> beginEntryOffset >> endEntryOffset;
+
+    // The headers of the subclasses, see their saveHeader()
+    QList<QPair<QString, qint32>> extraDicts;
+    qint32 offerListOffset = 0;
+    qint32 timesOffset = 0;
+    QString mainDict = factoryName(factory.id) + QLatin1String(" by name");
+    qint32 i;
+    switch (factory.id) {
+    case KST_KServiceFactory:
+        m_str >> i;
+        extraDicts.append({QStringLiteral("services by desktop name"), i});
+        m_str >> i;
+        extraDicts.append({QStringLiteral("services by desktop path"), i});
+        m_str >> offerListOffset;
+        m_str >> i;
+        extraDicts.append({QStringLiteral("services by menu id"), i});
+        break;
+    case KST_KServiceGroupFactory:
+        mainDict = QStringLiteral("service groups by path");
+        m_str >> i;
+        extraDicts.append({QStringLiteral("service groups by base name"), i});
+        break;
+    case KST_CTimeInfo:
+        m_str >> timesOffset;
+        break;
+    }
+
+    // The linear index follows the entries
+    m_str.device()->seek(endEntryOffset);
+    qint32 entryCount;
+    m_str >> entryCount;
+    if (!ok() || entryCount < 0 || entryCount > (m_size - endEntryOffset) / 4) {
+        qWarning() << "The index of" << factoryName(factory.id) << "is corrupt";
+        return false;
+    }
+    QList<qint32> offsets(entryCount);
+    for (qint32 &offset : offsets) {
+        m_str >> offset;
+    }
+    m_out << "entries: " << entryCount << ", " << size(endEntryOffset - beginEntryOffset) << '\n';
+    m_out << "linear index: " << size(sizeof(qint32) * (entryCount + 1)) << '\n';
+    inspectEntries(endEntryOffset, offsets);
+
+    m_out << "\nhash tables:\n";
+    inspectDict(mainDict, dictOffset);
+    for (const auto &[name, offset] : std::as_const(extraDicts)) {
+        inspectDict(name, offset);
+    }
+    if (offerListOffset) {
+        inspectOfferList(offerListOffset);
+    }
+    if (timesOffset) {
+        inspectTimes(timesOffset);
+    }
+    return ok();
+}
+
+void Inspector::inspectEntries(qint32 endOffset, const QList<qint32> &offsets)
+{
+    if (offsets.isEmpty()) {
+        return;
+    }
+    // The size of a record is the distance to the next one
+    QList<qint32> sortedOffsets = offsets;
+    std::sort(sortedOffsets.begin(), sortedOffsets.end());
+
+    QMap<qint32, FieldSizes> fieldSizes; // by entry type
+    QMap<qint32, int> typeCounts;
+    QList<Entry> entries;
+    entries.reserve(sortedOffsets.count());
+    for (int i = 0; i < sortedOffsets.count(); ++i) {
+        Entry entry{sortedOffsets.at(i), 0, (i + 1 < sortedOffsets.count() ? sortedOffsets.at(i + 1) : endOffset) - sortedOffsets.at(i), QString()};
+        const FieldSizes sizes = readRecord(entry);
+        FieldSizes &total = fieldSizes[entry.type];
+        for (const QString &field : sizes.fields) {
+            total.add(field, sizes.sizes.value(field));
+        }
+        ++typeCounts[entry.type];
+        entries.append(entry);
+    }
+
+    for (auto it = fieldSizes.cbegin(); it != fieldSizes.cend(); ++it) {
+        const int count = typeCounts.value(it.key());
+        m_out << '\n' << count << ' ' << entryTypeName(it.key()) << " entries, bytes by field:\n";
+        for (const QString &field : it->fields) {
+            const qint64 bytes = it->sizes.value(field);
+            m_out << qSetFieldWidth(28) << Qt::left << (QLatin1String("  ") + field) << qSetFieldWidth(12) << Qt::right << bytes << qSetFieldWidth(0)
+                  << "  avg " << QString::number(double(bytes) / count, 'f', 1) << '\n';
+        }
+    }
+
+    std::partial_sort(entries.begin(), entries.begin() + std::min<qsizetype>(m_topCount, entries.count()), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.size > b.size;
+    });
+    m_out << "\nlargest entries:\n";
+    for (int i = 0; i < std::min<qsizetype>(m_topCount, entries.count()); ++i) {
+        m_out << qSetFieldWidth(10) << Qt::right << entries.at(i).size << qSetFieldWidth(0) << "  " << entries.at(i).path << '\n';
+    }
+}
+
+FieldSizes Inspector::readRecord(Entry &entry)
+{
+    FieldSizes sizes;
+    m_str.device()->seek(entry.offset);
+    qint64 pos = entry.offset;
+    const auto field = [&](const QString &name, auto &&value) {
+        m_str >> value;
+        const qint64 newPos = m_str.device()->pos();
+        sizes.add(name, newPos - pos);
+        pos = newPos;
+    };
+    const auto unused = QStringLiteral("(unused)");
+    qint8 flag;
+    QString string;
+    QStringList list;
+
+    field(QStringLiteral("(type)"), entry.type);
+    field(QStringLiteral("path"), entry.path);
+
+    // See the load() methods of the entries
+    switch (entry.type) {
+    case KST_KService: {
+        QMap<QString, QVariant> properties;
+        QList<KServiceAction> actions;
+        QByteArray actionsData;
+        field(QStringLiteral("Type"), string);
+        field(QStringLiteral("Name"), string);
+        field(QStringLiteral("Exec"), string);
+        field(QStringLiteral("Icon"), string);
+        field(QStringLiteral("Terminal"), flag);
+        field(QStringLiteral("TerminalOptions"), string);
+        field(QStringLiteral("Path"), string);
+        field(QStringLiteral("Comment"), string);
+        field(unused, flag);
+        field(QStringLiteral("other properties"), properties);
+        field(unused, string);
+        field(unused, flag);
+        field(QStringLiteral("desktop entry name"), string);
+        field(QStringLiteral("Keywords"), list);
+        field(QStringLiteral("GenericName"), string);
+        field(QStringLiteral("Categories"), list);
+        field(QStringLiteral("menu id"), string);
+        field(unused, actions);
+        field(unused, list);
+        field(QStringLiteral("untranslated Name"), string);
+        field(QStringLiteral("untranslated GenericName"), string);
+        field(QStringLiteral("MimeType"), list);
+        field(QStringLiteral("Actions"), actionsData);
+        break;
+    }
+    case KST_KServiceGroup: {
+        qint32 childCount;
+        field(QStringLiteral("Name"), string);
+        field(QStringLiteral("Icon"), string);
+        field(QStringLiteral("Comment"), string);
+        field(QStringLiteral("children"), list);
+        field(QStringLiteral("base group name"), string);
+        field(QStringLiteral("child count"), childCount);
+        field(QStringLiteral("NoDisplay"), flag);
+        field(QStringLiteral("X-KDE-SuppressGenericNames"), list);
+        field(QStringLiteral("directory entry path"), string);
+        field(QStringLiteral("SortOrder"), list);
+        field(QStringLiteral("flags"), flag);
+        field(QStringLiteral("flags"), flag);
+        field(QStringLiteral("flags"), flag);
+        field(QStringLiteral("flags"), flag);
+        break;
+    }
+    case KST_KMimeTypeEntry: {
+        qint32 offersOffset;
+        field(QStringLiteral("name"), string);
+        field(QStringLiteral("offers offset"), offersOffset);
+        break;
+    }
+    }
+    // Anything we don't know about, e.g. fields added by a newer version
+    if (pos < entry.offset + entry.size) {
+        sizes.add(QStringLiteral("(other)"), entry.offset + entry.size - pos);
+    }
+    return sizes;
+}
+
+void Inspector::inspectDict(const QString &name, qint32 offset)
+{
+    m_str.device()->seek(offset);
+    quint32 tableSize;
+    QList<qint32> hashList;
+    m_str >> tableSize >> hashList;
+    if (!ok() || tableSize == 0) {
+        m_out << "  " << name << ": empty\n";
+        return;
+    }
+    const qint64 tableStart = m_str.device()->pos();
+    const qint64 tableEnd = tableStart + sizeof(qint32) * tableSize;
+    if (tableEnd > m_size) {
+        m_out << "  " << name << ": corrupt, " << tableSize << " slots\n";
+        return;
+    }
+    QList<qint32> table(tableSize);
+    for (qint32 &slot : table) {
+        m_str >> slot;
+    }
+
+    struct Chain {
+        quint32 slot;
+        QStringList keys;
+    };
+    QList<Chain> chains;
+    int directKeys = 0;
+    qint64 end = tableEnd;
+    for (quint32 slot = 0; slot < tableSize; ++slot) {
+        const qint32 value = table.at(slot);
+        if (value > 0) {
+            ++directKeys;
+        } else if (value < 0) {
+            // A duplicate list: (offset, key) pairs, ending with a 0 offset
+            Chain chain{slot, {}};
+            m_str.device()->seek(-qint64(value));
+            while (ok()) {
+                qint32 entryOffset;
+                m_str >> entryOffset;
+                if (entryOffset == 0) {
+                    break;
+                }
+                QString key;
+                m_str >> key;
+                chain.keys.append(key);
+            }
+            end = std::max(end, m_str.device()->pos());
+            chains.append(chain);
+        }
+    }
+
+    qint64 chainedKeys = 0;
+    qint64 stepsForAllHits = 0; // a hit on the n-th key of a list compares n keys
+    QMap<qsizetype, int> histogram;
+    for (const Chain &chain : std::as_const(chains)) {
+        const qsizetype length = chain.keys.count();
+        chainedKeys += length;
+        stepsForAllHits += length * (length + 1) / 2;
+        ++histogram[length];
+    }
+    const qint64 keys = directKeys + chainedKeys;
+
+    m_out << "  " << name << ": " << keys << " keys in " << tableSize << " slots, load factor " << QString::number(double(keys) / tableSize, 'f', 2)
+          << ", " << size(end - offset) << '\n';
+    m_out << "    hashList (" << hashList.count() << " positions):";
+    for (qint32 position : std::as_const(hashList)) {
+        m_out << ' ' << position;
+    }
+    m_out << '\n';
+    m_out << "    " << directKeys << " keys alone in their slot, " << chainedKeys << " in " << chains.count() << " duplicate lists ("
+          << size(end - tableEnd) << "), " << QString::number(keys ? double(stepsForAllHits) / keys : 0, 'f', 2) << " list steps per hit on average\n";
+    if (histogram.isEmpty()) {
+        return;
+    }
+    m_out << "    duplicate list lengths:";
+    for (auto it = histogram.cbegin(); it != histogram.cend(); ++it) {
+        m_out << ' ' << it.key() << "x" << it.value();
+    }
+    m_out << '\n';
+
+    std::stable_sort(chains.begin(), chains.end(), [](const Chain &a, const Chain &b) {
+        return a.keys.count() > b.keys.count();
+    });
+    m_out << "    longest duplicate lists:\n";
+    for (int i = 0; i < std::min<qsizetype>(m_topCount, chains.count()); ++i) {
+        m_out << "      slot " << chains.at(i).slot << ": " << chains.at(i).keys.join(QLatin1String(", ")) << '\n';
+    }
+}
+
+void Inspector::inspectOfferList(qint32 offset)
+{
+    // Records of (MIME type entry, service, preference, inheritance level), grouped by MIME type, see KBuildServiceFactory::saveOfferList
+    m_str.device()->seek(offset);
+    QHash<qint32, int> offerCounts;
+    int offers = 0;
+    while (ok()) {
+        qint32 mimeTypeOffset;
+        qint32 serviceOffset;
+        qint32 preference;
+        qint32 inheritanceLevel;
+        m_str >> mimeTypeOffset;
+        if (mimeTypeOffset == 0) {
+            break;
+        }
+        m_str >> serviceOffset >> preference >> inheritanceLevel;
+        ++offerCounts[mimeTypeOffset];
+        ++offers;
+    }
+    m_out << "\noffer list: " << offers << " offers for " << offerCounts.count() << " MIME types, " << size(m_str.device()->pos() - offset) << '\n';
+
+    QList<QPair<int, qint32>> fanOut; // number of offers, MIME type entry
+    fanOut.reserve(offerCounts.count());
+    for (auto it = offerCounts.cbegin(); it != offerCounts.cend(); ++it) {
+        fanOut.append({it.value(), it.key()});
+    }
+    std::sort(fanOut.begin(), fanOut.end(), std::greater<>());
+    m_out << "MIME types with most offers:\n";
+    for (int i = 0; i < std::min<qsizetype>(m_topCount, fanOut.count()); ++i) {
+        m_out << qSetFieldWidth(10) << Qt::right << fanOut.at(i).first << qSetFieldWidth(0) << "  " << mimeTypeName(fanOut.at(i).second) << '\n';
+    }
+}
+
+void Inspector::inspectTimes(qint32 offset)
+{
+    // (key, ctime) pairs, ending with an empty key, see KCTimeDict::save
+    m_str.device()->seek(offset);
+    int count = 0;
+    while (ok()) {
+        QString key;
+        quint32 ctime;
+        m_str >> key >> ctime;
+        if (key.isEmpty()) {
+            break;
+        }
+        ++count;
+    }
+    m_out << "file times: " << count << ", " << size(m_str.device()->pos() - offset) << '\n';
+}
+
+QString Inspector::mimeTypeName(qint32 offset)
+{
+    const qint64 pos = m_str.device()->pos();
+    m_str.device()->seek(offset);
+    qint32 type;
+    QString path;
+    QString name;
+    m_str >> type >> path >> name;
+    m_str.device()->seek(pos);
+    return type == KST_KMimeTypeEntry ? name : QStringLiteral("(entry at %1)").arg(offset);
+}
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Reports the sizes of the sections of a ksycoca database and the quality of its hash tables"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("database"), QStringLiteral("The database file, by default the one used in this environment"), QStringLiteral("[database]"));
+    QCommandLineOption top(QStringLiteral("top"), QStringLiteral("How many of the largest entries, longest lists etc. to print"), QStringLiteral("n"), QStringLiteral("10"));
+    parser.addOption(top);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const QString path = args.isEmpty() ? KSycoca::absoluteFilePath() : args.first();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << "Couldn't open " << path << ": " << file.errorString() << '\n';
+        return 1;
+    }
+    QTextStream(stdout) << "database: " << path << '\n';
+
+    // The delta isn't inspected, it only replaces a few records and offer lists
+    KSycocaDelta delta;
+    if (delta.load(path, QFileInfo(file).lastModified().toMSecsSinceEpoch())) {
+        QTextStream(stdout) << "delta: " << delta.recordCount() << " records (" << delta.addedOffsets().size() << " added) and " << delta.offerListCount()
+                            << " offer lists replaced by " << KSycocaDelta::filePath(path) << '\n';
+    }
+
+    Inspector inspector(&file, std::max(1, parser.value(top).toInt()));
+    return inspector.run() ? 0 : 1;
+}